@@ -14,14 +14,51 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "Cgroup.h"
+#include "Proc.h"
 
-#include <fstream>
-
-#include <boost/filesystem.hpp>
-#include <boost/algorithm/string.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 const string Cgroup::CGROUP_ROOT = "/sys/fs/cgroup/unified"; /* TODO: use memcg v2 */
 const string Cgroup::CGROUP_PROCS = "cgroup.procs";
+const string Cgroup::CGROUP_EVENTS = "cgroup.events";
+const string Cgroup::CGROUP_FREEZE = "cgroup.freeze";
+const string Cgroup::MEMORY_EVENTS = "memory.events";
+const string Cgroup::MEMORY_PRESSURE = "memory.pressure";
+const string Cgroup::MEMORY_CURRENT = "memory.current";
+const string Cgroup::MEMORY_SWAP_CURRENT = "memory.swap.current";
+const string Cgroup::MEMORY_STAT = "memory.stat";
+const string Cgroup::MEMORY_RECLAIM = "memory.reclaim";
+
+/* Keys of memory.stat which are stored in MemcgUsage */
+static const struct {
+    const char* key;
+    size_t len;
+    unsigned long long MemcgUsage::*field;
+} MEMORY_STAT_KEYS[] = {
+    { "anon",         sizeof("anon") - 1,         &MemcgUsage::anon },
+    { "file",         sizeof("file") - 1,         &MemcgUsage::file },
+    { "shmem",        sizeof("shmem") - 1,        &MemcgUsage::shmem },
+    { "slab",         sizeof("slab") - 1,         &MemcgUsage::slab },
+    { "kernel_stack", sizeof("kernel_stack") - 1, &MemcgUsage::kernelStack },
+    { "pagetables",   sizeof("pagetables") - 1,   &MemcgUsage::pageTables },
+    { "sock",         sizeof("sock") - 1,         &MemcgUsage::sock },
+};
+
+/* Read a small cgroup file once into <buf> */
+static bool readFile(const string& file, char* buf, size_t size, size_t& len)
+{
+    int fd = -1;
+    bool ret = Proc::preadFile(file.c_str(), fd, buf, size, len);
+
+    if (fd >= 0)
+        close(fd);
+    return ret;
+}
 
 string Cgroup::generatePath(const bool isHost, const string& uid)
 {
@@ -38,38 +75,189 @@ string Cgroup::generatePath(const bool isHost, const string& uid)
     return p;
 }
 
-/* Fill p_comm_pids by iterating <path> recursively */
-void Cgroup::iterateDir(map<string, list<int>>& p_comm_pids, string path)
+/* Read <path>/memory.events. <fd> is kept open for next read */
+bool Cgroup::getMemoryEvents(const string& path, int& fd, MemcgEvents& events)
 {
-    for (auto &&x : boost::filesystem::directory_iterator(path)) {
-        if (boost::filesystem::is_directory(x.path())) {
-            iterateDir(p_comm_pids, x.path().string());
+    const string file = path + "/" + MEMORY_EVENTS;
+    char buf[256];
+    size_t len = 0;
+
+    memset(&events, 0, sizeof(events));
+
+    if (!Proc::preadFile(file.c_str(), fd, buf, sizeof(buf), len))
+        return false;
+
+    char* line = buf;
+    while (line != NULL && *line != '\0') {
+        char key[32];
+        unsigned long value = 0;
+        char* next = strchr(line, '\n');
+
+        if (next != NULL)
+            *next++ = '\0';
+
+        if (sscanf(line, "%31s %lu", key, &value) == 2) {
+            if (strcmp(key, "low") == 0)
+                events.low = value;
+            else if (strcmp(key, "high") == 0)
+                events.high = value;
+            else if (strcmp(key, "max") == 0)
+                events.max = value;
+            else if (strcmp(key, "oom") == 0)
+                events.oom = value;
+            else if (strcmp(key, "oom_kill") == 0)
+                events.oomKill = value;
         }
+        line = next;
     }
 
-    string procs = path + "/" + CGROUP_PROCS;
-    ifstream ifs(procs.c_str());
-    if (ifs.fail()) {
-        Logger::error("Fail to open cgroup.procs", "Cgroup");
-        return;
-    }
+    return true;
+}
 
-    while (true) {
-        list<int> pids;
-        string pid;
+/*
+ * Read usage of <path> from memory.current, memory.swap.current and
+ * memory.stat. Unlike PSS, it includes kernel memory charged to the group.
+ */
+bool Cgroup::getMemoryUsage(const string& path, MemcgUsage& usage)
+{
+    char buf[8192];
+    size_t len = 0;
 
-        if (!std::getline(ifs, pid))
-            break;
+    memset(&usage, 0, sizeof(usage));
 
-        pids.push_back(stoi(pid));
+    if (!readFile(path + "/" + MEMORY_CURRENT, buf, sizeof(buf), len))
+        return false;
+    usage.current = strtoull(buf, NULL, 10);
 
-        boost::filesystem::path comm_path{path.c_str()};
-        string key = comm_path.filename().string();
+    /* No swap controller without swap */
+    if (readFile(path + "/" + MEMORY_SWAP_CURRENT, buf, sizeof(buf), len))
+        usage.swapCurrent = strtoull(buf, NULL, 10);
 
-        if (p_comm_pids.find(key) == p_comm_pids.end()) {
-            p_comm_pids.insert(make_pair(key, pids));
-        } else {
-            p_comm_pids[key].merge(pids);
+    if (!readFile(path + "/" + MEMORY_STAT, buf, sizeof(buf), len))
+        return true;
+
+    const char* p = buf;
+    const char* end = buf + len;
+    while (p < end) {
+        const char* key = p;
+        const char* sp = (const char*)memchr(p, ' ', end - p);
+        if (!sp)
+            break;
+
+        size_t keyLen = sp - key;
+        for (const auto& k : MEMORY_STAT_KEYS) {
+            if (k.len == keyLen && memcmp(k.key, key, keyLen) == 0) {
+                usage.*(k.field) = strtoull(sp + 1, NULL, 10);
+                break;
+            }
         }
+
+        const char* nl = (const char*)memchr(sp, '\n', end - sp);
+        if (!nl)
+            break;
+        p = nl + 1;
     }
+
+    return true;
+}
+
+/* cgroup v2 path of <pid>, from "0::<path>" line of /proc/<pid>/cgroup */
+bool Cgroup::getPathOfPid(const int pid, string& path)
+{
+    char file[32];
+    char buf[1024];
+    size_t len = 0;
+
+    snprintf(file, sizeof(file), "/proc/%d/cgroup", pid);
+    if (!readFile(file, buf, sizeof(buf), len))
+        return false;
+
+    char* line = strstr(buf, "0::");
+    if (line == NULL || (line != buf && line[-1] != '\n'))
+        return false;
+
+    line += 3;
+    char* end = strchr(line, '\n');
+    if (end != NULL)
+        *end = '\0';
+
+    path = CGROUP_ROOT + line;
+    return true;
+}
+
+/* Processes in <path> itself, not in its children */
+bool Cgroup::getProcs(const string& path, vector<int>& pids)
+{
+    const string file = path + "/" + CGROUP_PROCS;
+    int pid;
+
+    pids.clear();
+
+    FILE* fp = fopen(file.c_str(), "re");
+    if (fp == NULL)
+        return false;
+
+    while (fscanf(fp, "%d", &pid) == 1)
+        pids.push_back(pid);
+
+    fclose(fp);
+    return true;
+}
+
+/*
+ * Ask kernel to reclaim <bytes> from <path> through memory.reclaim.
+ * swappiness is passed if it is not negative, kernel older than 6.5
+ * rejects it and the request is done again without it. <reclaimed> is
+ * measured from memory.current, as the write fails with EAGAIN when less
+ * than requested is reclaimed.
+ */
+bool Cgroup::reclaim(const string& path, unsigned long long bytes, int swappiness,
+                     unsigned long long& reclaimed)
+{
+    static bool swappinessSupported = true;
+    const string file = path + "/" + MEMORY_RECLAIM;
+    MemcgUsage before, after;
+    char request[64];
+
+    reclaimed = 0;
+
+    if (!getMemoryUsage(path, before))
+        return false;
+
+    int fd = open(file.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    ssize_t ret = -1;
+    if (swappiness >= 0 && swappinessSupported) {
+        snprintf(request, sizeof(request), "%llu swappiness=%d", bytes, swappiness);
+        ret = write(fd, request, strlen(request));
+        if (ret < 0 && errno == EINVAL)
+            swappinessSupported = false;
+    }
+    if (ret < 0 && (swappiness < 0 || !swappinessSupported)) {
+        snprintf(request, sizeof(request), "%llu", bytes);
+        ret = write(fd, request, strlen(request));
+    }
+    int err = (ret < 0) ? errno : 0;
+    close(fd);
+
+    if (getMemoryUsage(path, after) && after.current < before.current)
+        reclaimed = before.current - after.current;
+
+    return err == 0 || err == EAGAIN;
+}
+
+/* Freeze or thaw all processes in <path> through cgroup.freeze */
+bool Cgroup::freeze(const string& path, bool frozen)
+{
+    const string file = path + "/" + CGROUP_FREEZE;
+
+    int fd = open(file.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    ssize_t ret = write(fd, frozen ? "1" : "0", 1);
+    close(fd);
+    return ret == 1;
 }
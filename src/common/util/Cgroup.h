@@ -20,22 +20,60 @@
 #include <iostream>
 #include <map>
 #include <list>
+#include <vector>
 
 #include "util/Logger.h"
 
 using namespace std;
 
+/* Counters of memcg v2 memory.events */
+struct MemcgEvents {
+    unsigned long low;
+    unsigned long high;
+    unsigned long max;
+    unsigned long oom;
+    unsigned long oomKill;
+};
+
+/* Memory usage of a memcg v2 group in bytes */
+struct MemcgUsage {
+    unsigned long long current;     // memory.current
+    unsigned long long swapCurrent; // memory.swap.current
+    unsigned long long anon;        // memory.stat
+    unsigned long long file;
+    unsigned long long shmem;
+    unsigned long long slab;
+    unsigned long long kernelStack;
+    unsigned long long pageTables;
+    unsigned long long sock;
+};
+
 class Cgroup {
 public:
     Cgroup() {}
     virtual ~Cgroup() {}
 
     static string generatePath(const bool isHost, const string& uid);
-    static void iterateDir(map<string, list<int>>& p_comm_pids, string path);
+    static bool getMemoryEvents(const string& path, int& fd, MemcgEvents& events);
+    static bool getMemoryUsage(const string& path, MemcgUsage& usage);
+    static bool getPathOfPid(const int pid, string& path);
+    static bool getProcs(const string& path, vector<int>& pids);
+    static bool reclaim(const string& path, unsigned long long bytes, int swappiness,
+                        unsigned long long& reclaimed);
+    static bool freeze(const string& path, bool frozen);
+
+    static const string CGROUP_PROCS;
+    static const string CGROUP_EVENTS;
+    static const string CGROUP_FREEZE;
+    static const string MEMORY_EVENTS;
+    static const string MEMORY_PRESSURE;
+    static const string MEMORY_CURRENT;
+    static const string MEMORY_SWAP_CURRENT;
+    static const string MEMORY_STAT;
+    static const string MEMORY_RECLAIM;
 
 private:
     static const string CGROUP_ROOT;
-    static const string CGROUP_PROCS;
 };
 
 #endif /* UTIL_CGROUP_H_ */
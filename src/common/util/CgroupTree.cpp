@@ -0,0 +1,266 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "CgroupTree.h"
+#include "Cgroup.h"
+#include "Logger.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+
+#define LOG_NAME "CgroupTree"
+
+/* Same layout as struct linux_dirent64 */
+struct Dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+CgroupTree::Node* CgroupTree::addNode(Node* parent, const string& name)
+{
+    int parentFd = parent ? parent->dirFd : AT_FDCWD;
+    int fd = openat(parentFd, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    Node* node = new Node;
+    node->path = parent ? parent->path + "/" + name : name;
+    node->name = parent ? name : node->path.substr(node->path.rfind('/') + 1);
+    node->dirFd = fd;
+    node->parent = parent;
+
+    /* inotify takes path only. Both are resolved once here */
+    const string events = node->path + "/" + Cgroup::CGROUP_EVENTS;
+    node->dirWd = inotify_add_watch(m_inotifyFd, node->path.c_str(),
+                                    IN_CREATE | IN_DELETE | IN_ONLYDIR);
+    node->eventsWd = inotify_add_watch(m_inotifyFd, events.c_str(), IN_MODIFY);
+    if (node->dirWd >= 0)
+        m_watches[node->dirWd] = node;
+    if (node->eventsWd >= 0)
+        m_watches[node->eventsWd] = node;
+
+    if (parent)
+        parent->children.push_back(node);
+
+    scanChildren(node);
+    readProcs(node);
+    return node;
+}
+
+void CgroupTree::removeNode(Node* node)
+{
+    while (!node->children.empty())
+        removeNode(node->children.front());
+
+    /* Watches of removed directory are dropped by kernel with IN_IGNORED */
+    for (int wd : { node->dirWd, node->eventsWd }) {
+        if (wd < 0)
+            continue;
+        inotify_rm_watch(m_inotifyFd, wd);
+        m_watches.erase(wd);
+    }
+
+    ::close(node->dirFd);
+    if (node->parent)
+        node->parent->children.remove(node);
+    delete node;
+}
+
+void CgroupTree::scanChildren(Node* node)
+{
+    char buf[4096];
+    long len;
+
+    lseek(node->dirFd, 0, SEEK_SET);
+    while ((len = syscall(SYS_getdents64, node->dirFd, buf, sizeof(buf))) > 0) {
+        for (long pos = 0; pos < len;) {
+            Dirent64* d = (Dirent64*)(buf + pos);
+            pos += d->d_reclen;
+
+            if (d->d_type != DT_DIR || strcmp(d->d_name, ".") == 0 ||
+                strcmp(d->d_name, "..") == 0)
+                continue;
+
+            addNode(node, d->d_name);
+        }
+    }
+}
+
+void CgroupTree::readProcs(Node* node)
+{
+    char buf[4096];
+    ssize_t len;
+    size_t keep = 0;
+
+    node->pids.clear();
+
+    int fd = openat(node->dirFd, Cgroup::CGROUP_PROCS.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    /* A pid may be split between reads, keep the tail for next read */
+    while ((len = read(fd, buf + keep, sizeof(buf) - keep - 1)) > 0) {
+        char* p = buf;
+        char* end = buf + keep + len;
+        *end = '\0';
+
+        while (p < end) {
+            char* nl = (char*)memchr(p, '\n', end - p);
+            if (!nl)
+                break;
+            node->pids.push_back(atoi(p));
+            p = nl + 1;
+        }
+
+        keep = end - p;
+        memmove(buf, p, keep);
+    }
+
+    ::close(fd);
+}
+
+bool CgroupTree::update()
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t len;
+
+    while ((len = read(m_inotifyFd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + len;) {
+            struct inotify_event* ev = (struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                /* Events are lost, build the tree again */
+                Logger::warning("inotify queue overflow, rescan " + m_root, LOG_NAME);
+                rebuild();
+                return true;
+            }
+
+            auto it = m_watches.find(ev->wd);
+            if (it == m_watches.end())
+                continue;
+
+            Node* node = it->second;
+            if (ev->mask & IN_IGNORED) {
+                m_watches.erase(it);
+                if (ev->wd == node->dirWd)
+                    node->dirWd = -1;
+                else if (ev->wd == node->eventsWd)
+                    node->eventsWd = -1;
+            } else if (ev->wd == node->eventsWd) {
+                readProcs(node);
+                changed = true;
+            } else if (ev->mask & IN_CREATE) {
+                addNode(node, ev->name);
+                changed = true;
+            } else if (ev->mask & IN_DELETE) {
+                for (Node* child : node->children) {
+                    if (child->name == ev->name) {
+                        removeNode(child);
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return changed;
+}
+
+void CgroupTree::getPids(const Node* node, map<string, list<int>>& comm_pids) const
+{
+    for (const Node* child : node->children)
+        getPids(child, comm_pids);
+
+    if (node->pids.empty())
+        return;
+
+    list<int>& pids = comm_pids[node->name];
+    pids.insert(pids.end(), node->pids.begin(), node->pids.end());
+}
+
+void CgroupTree::getPids(map<string, list<int>>& comm_pids) const
+{
+    if (m_rootNode)
+        getPids(m_rootNode, comm_pids);
+}
+
+bool CgroupTree::rebuild()
+{
+    if (m_rootNode) {
+        removeNode(m_rootNode);
+        m_rootNode = nullptr;
+    }
+
+    m_rootNode = addNode(nullptr, m_root);
+    if (!m_rootNode) {
+        Logger::warning("Fail to open " + m_root + ": " + string(strerror(errno)), LOG_NAME);
+        return false;
+    }
+
+    return true;
+}
+
+bool CgroupTree::open(const string& root)
+{
+    close();
+
+    m_root = root;
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        Logger::error("Fail to init inotify: " + string(strerror(errno)), LOG_NAME);
+        return false;
+    }
+
+    return rebuild();
+}
+
+void CgroupTree::close()
+{
+    if (m_rootNode) {
+        removeNode(m_rootNode);
+        m_rootNode = nullptr;
+    }
+
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+
+    m_watches.clear();
+}
+
+CgroupTree::CgroupTree()
+    : m_rootNode(nullptr),
+      m_inotifyFd(-1)
+{
+}
+
+CgroupTree::~CgroupTree()
+{
+    close();
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef UTIL_CGROUPTREE_H_
+#define UTIL_CGROUPTREE_H_
+
+#include <iostream>
+#include <map>
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+/*
+ * In-memory index of a cgroup v2 subtree and pids of each cgroup.
+ * Directories are kept open and walked with openat/getdents64, so that
+ * nothing is resolved from the root again. After open(), the tree is
+ * updated incrementally from inotify : directory creation and removal,
+ * and cgroup.events which is modified when a cgroup becomes populated or
+ * empty. Poll getFd() and call update() when it is readable.
+ */
+class CgroupTree {
+public:
+    explicit CgroupTree();
+    virtual ~CgroupTree();
+
+    bool open(const string& root);
+    void close();
+    int getFd() const { return m_inotifyFd; }
+
+    /* Returns true if any cgroup or pid is changed */
+    bool update();
+
+    /* pids grouped by cgroup name, same as former Cgroup::iterateDir */
+    void getPids(map<string, list<int>>& comm_pids) const;
+
+private:
+    struct Node {
+        string path;
+        string name;
+        int dirFd;
+        int dirWd;              // watches creation and removal of children
+        int eventsWd;           // watches cgroup.events
+        Node* parent;
+        list<Node*> children;
+        vector<int> pids;
+    };
+
+    bool rebuild();
+    Node* addNode(Node* parent, const string& name);
+    void removeNode(Node* node);
+    void scanChildren(Node* node);
+    void readProcs(Node* node);
+    void getPids(const Node* node, map<string, list<int>>& comm_pids) const;
+
+    string m_root;
+    Node* m_rootNode;
+    int m_inotifyFd;
+    unordered_map<int, Node*> m_watches;    // inotify wd to node
+};
+
+#endif /* UTIL_CGROUPTREE_H_ */
@@ -20,12 +20,250 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/regex.hpp>
 
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
 #include <iostream>
 #include <sstream>
 #include <string>
 
 #define LOG_NAME "PROC"
 
+/* Not every libc or kernel header defines them yet */
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+#ifndef __NR_process_madvise
+#define __NR_process_madvise 440
+#endif
+
+/* iovecs passed to process_madvise at once, UIO_MAXIOV */
+#define ADVISE_IOV_MAX 1024
+
+thread_local int Proc::m_memInfoFd = -1;
+thread_local int Proc::m_memPressureFd = -1;
+thread_local int Proc::m_vmStatFd = -1;
+
+/* Keys of /proc/meminfo which are stored in MemInfoSnapshot */
+static const struct {
+    const char* key;
+    size_t len;
+    unsigned long MemInfoSnapshot::*field;
+} MEMINFO_KEYS[] = {
+    { "MemTotal",       sizeof("MemTotal") - 1,       &MemInfoSnapshot::memTotal },
+    { "MemFree",        sizeof("MemFree") - 1,        &MemInfoSnapshot::memFree },
+    { "MemAvailable",   sizeof("MemAvailable") - 1,   &MemInfoSnapshot::memAvailable },
+    { "Buffers",        sizeof("Buffers") - 1,        &MemInfoSnapshot::buffers },
+    { "Cached",         sizeof("Cached") - 1,         &MemInfoSnapshot::cached },
+    { "SwapCached",     sizeof("SwapCached") - 1,     &MemInfoSnapshot::swapCached },
+    { "Active",         sizeof("Active") - 1,         &MemInfoSnapshot::active },
+    { "Inactive",       sizeof("Inactive") - 1,       &MemInfoSnapshot::inactive },
+    { "Active(anon)",   sizeof("Active(anon)") - 1,   &MemInfoSnapshot::activeAnon },
+    { "Inactive(anon)", sizeof("Inactive(anon)") - 1, &MemInfoSnapshot::inactiveAnon },
+    { "Active(file)",   sizeof("Active(file)") - 1,   &MemInfoSnapshot::activeFile },
+    { "Inactive(file)", sizeof("Inactive(file)") - 1, &MemInfoSnapshot::inactiveFile },
+    { "SwapTotal",      sizeof("SwapTotal") - 1,      &MemInfoSnapshot::swapTotal },
+    { "SwapFree",       sizeof("SwapFree") - 1,       &MemInfoSnapshot::swapFree },
+    { "Dirty",          sizeof("Dirty") - 1,          &MemInfoSnapshot::dirty },
+    { "AnonPages",      sizeof("AnonPages") - 1,      &MemInfoSnapshot::anonPages },
+    { "Mapped",         sizeof("Mapped") - 1,         &MemInfoSnapshot::mapped },
+    { "Shmem",          sizeof("Shmem") - 1,          &MemInfoSnapshot::shmem },
+    { "Slab",           sizeof("Slab") - 1,           &MemInfoSnapshot::slab },
+    { "SReclaimable",   sizeof("SReclaimable") - 1,   &MemInfoSnapshot::sReclaimable },
+    { "SUnreclaim",     sizeof("SUnreclaim") - 1,     &MemInfoSnapshot::sUnreclaim },
+};
+
+/* Keys of /proc/vmstat which are added to VmStatSnapshot. prefix matches key* */
+static const struct {
+    const char* key;
+    size_t len;
+    bool prefix;
+    unsigned long long VmStatSnapshot::*field;
+} VMSTAT_KEYS[] = {
+    { "pgscan_kswapd",           sizeof("pgscan_kswapd") - 1,           false, &VmStatSnapshot::pgscan },
+    { "pgscan_direct",           sizeof("pgscan_direct") - 1,           false, &VmStatSnapshot::pgscan },
+    { "pgscan_khugepaged",       sizeof("pgscan_khugepaged") - 1,       false, &VmStatSnapshot::pgscan },
+    { "pgsteal_kswapd",          sizeof("pgsteal_kswapd") - 1,          false, &VmStatSnapshot::pgsteal },
+    { "pgsteal_direct",          sizeof("pgsteal_direct") - 1,          false, &VmStatSnapshot::pgsteal },
+    { "pgsteal_khugepaged",      sizeof("pgsteal_khugepaged") - 1,      false, &VmStatSnapshot::pgsteal },
+    { "workingset_refault_anon", sizeof("workingset_refault_anon") - 1, false, &VmStatSnapshot::refaultAnon },
+    { "workingset_refault_file", sizeof("workingset_refault_file") - 1, false, &VmStatSnapshot::refaultFile },
+    { "workingset_refault",      sizeof("workingset_refault") - 1,      false, &VmStatSnapshot::refaultFile },
+    { "pswpin",                  sizeof("pswpin") - 1,                  false, &VmStatSnapshot::pswpin },
+    { "pswpout",                 sizeof("pswpout") - 1,                 false, &VmStatSnapshot::pswpout },
+    { "allocstall",              sizeof("allocstall") - 1,              true,  &VmStatSnapshot::allocstall },
+};
+
+/*
+ * Read whole <path> into <buf> from offset 0. The file is opened only once
+ * and <fd> is kept open, so that periodic readers do not allocate anything.
+ */
+bool Proc::preadFile(const char* path, int& fd, char* buf, size_t size,
+                     size_t& len)
+{
+    ssize_t ret = -1;
+
+    for (int retry = 0; retry < 2; ++retry) {
+        if (fd < 0)
+            fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+
+        ret = pread(fd, buf, size - 1, 0);
+        if (ret >= 0)
+            break;
+
+        /* fd became unusable, reopen it once */
+        close(fd);
+        fd = -1;
+    }
+
+    if (ret < 0)
+        return false;
+
+    buf[ret] = '\0';
+    len = (size_t)ret;
+    return true;
+}
+
+bool Proc::getMemInfo(MemInfoSnapshot& snapshot)
+{
+    char buf[4096];
+    size_t len = 0;
+
+    memset(&snapshot, 0, sizeof(snapshot));
+
+    if (!preadFile("/proc/meminfo", m_memInfoFd, buf, sizeof(buf), len))
+        return false;
+
+    const char* p = buf;
+    const char* end = buf + len;
+    while (p < end) {
+        const char* key = p;
+        const char* colon = (const char*)memchr(p, ':', end - p);
+        if (colon == NULL)
+            break;
+
+        /* Parse decimal value which follows ':' */
+        const char* v = colon + 1;
+        while (v < end && *v == ' ')
+            ++v;
+        unsigned long value = 0;
+        while (v < end && *v >= '0' && *v <= '9')
+            value = value * 10 + (*v++ - '0');
+
+        size_t keyLen = colon - key;
+        for (const auto& k : MEMINFO_KEYS) {
+            if (k.len == keyLen && memcmp(k.key, key, keyLen) == 0) {
+                snapshot.*(k.field) = value;
+                break;
+            }
+        }
+
+        const char* nl = (const char*)memchr(v, '\n', end - v);
+        if (nl == NULL)
+            break;
+        p = nl + 1;
+    }
+
+    return snapshot.memTotal != 0;
+}
+
+bool Proc::getVmStat(VmStatSnapshot& snapshot)
+{
+    char buf[8192];
+    size_t len = 0;
+
+    memset(&snapshot, 0, sizeof(snapshot));
+
+    if (!preadFile("/proc/vmstat", m_vmStatFd, buf, sizeof(buf), len))
+        return false;
+
+    const char* p = buf;
+    const char* end = buf + len;
+    while (p < end) {
+        const char* key = p;
+        const char* space = (const char*)memchr(p, ' ', end - p);
+        if (space == NULL)
+            break;
+
+        const char* v = space + 1;
+        unsigned long long value = 0;
+        while (v < end && *v >= '0' && *v <= '9')
+            value = value * 10 + (*v++ - '0');
+
+        size_t keyLen = space - key;
+        for (const auto& k : VMSTAT_KEYS) {
+            if ((k.len == keyLen || (k.prefix && k.len < keyLen)) &&
+                memcmp(k.key, key, k.len) == 0) {
+                snapshot.*(k.field) += value;
+                break;
+            }
+        }
+
+        const char* nl = (const char*)memchr(v, '\n', end - v);
+        if (nl == NULL)
+            break;
+        p = nl + 1;
+    }
+
+    return true;
+}
+
+bool Proc::getMemPressure(PressureSnapshot& snapshot)
+{
+    return getPressure("/proc/pressure/memory", m_memPressureFd, snapshot);
+}
+
+/*
+ * Parse PSI file which has following format
+ * some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+ * full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+ */
+bool Proc::getPressure(const char* path, int& fd, PressureSnapshot& snapshot)
+{
+    char buf[256];
+    size_t len = 0;
+
+    memset(&snapshot, 0, sizeof(snapshot));
+
+    if (!preadFile(path, fd, buf, sizeof(buf), len))
+        return false;
+
+    char* line = buf;
+    while (line != NULL && *line != '\0') {
+        float avg10 = 0, avg60 = 0, avg300 = 0;
+        unsigned long long total = 0;
+        char* next = strchr(line, '\n');
+
+        if (next != NULL)
+            *next++ = '\0';
+
+        if (sscanf(line + 4, " avg10=%f avg60=%f avg300=%f total=%llu",
+                   &avg10, &avg60, &avg300, &total) == 4) {
+            if (strncmp(line, "some", 4) == 0) {
+                snapshot.someAvg10 = avg10;
+                snapshot.someAvg60 = avg60;
+                snapshot.someAvg300 = avg300;
+                snapshot.someTotal = total;
+            } else if (strncmp(line, "full", 4) == 0) {
+                snapshot.fullAvg10 = avg10;
+                snapshot.fullAvg60 = avg60;
+                snapshot.fullAvg300 = avg300;
+                snapshot.fullTotal = total;
+            }
+        }
+        line = next;
+    }
+
+    return true;
+}
+
 void Proc::getMemInfo(map<string, string>& mInfo)
 {
     std::ifstream ifs("/proc/meminfo");
@@ -52,6 +290,338 @@ void Proc::getMemInfo(map<string, string>& mInfo)
     ifs.close();
 }
 
+/* Keys of /proc/<pid>/smaps_rollup which are stored in SmapsRollupSnapshot */
+static const struct {
+    const char* key;
+    size_t len;
+    unsigned long SmapsRollupSnapshot::*field;
+} SMAPS_ROLLUP_KEYS[] = {
+    { "Rss",           sizeof("Rss") - 1,           &SmapsRollupSnapshot::rss },
+    { "Pss",           sizeof("Pss") - 1,           &SmapsRollupSnapshot::pss },
+    { "Pss_Anon",      sizeof("Pss_Anon") - 1,      &SmapsRollupSnapshot::pssAnon },
+    { "Pss_File",      sizeof("Pss_File") - 1,      &SmapsRollupSnapshot::pssFile },
+    { "Pss_Shmem",     sizeof("Pss_Shmem") - 1,     &SmapsRollupSnapshot::pssShmem },
+    { "Swap",          sizeof("Swap") - 1,          &SmapsRollupSnapshot::swap },
+    { "SwapPss",       sizeof("SwapPss") - 1,       &SmapsRollupSnapshot::swapPss },
+    { "Private_Clean", sizeof("Private_Clean") - 1, &SmapsRollupSnapshot::privateClean },
+    { "Private_Dirty", sizeof("Private_Dirty") - 1, &SmapsRollupSnapshot::privateDirty },
+};
+
+/*
+ * Called from PSS workers at the same time, so nothing is shared.
+ * Returns false when the process is gone.
+ */
+bool Proc::getSmapsRollup(const int pid, SmapsRollupSnapshot& snapshot)
+{
+    char path[32];
+    char buf[2048];
+    size_t len = 0;
+    int fd = -1;
+
+    memset(&snapshot, 0, sizeof(snapshot));
+
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+    bool ret = preadFile(path, fd, buf, sizeof(buf), len);
+    if (fd >= 0)
+        close(fd);
+    if (!ret || len == 0)
+        return false;
+
+    /* First line is the address range, skip it */
+    const char* p = (const char*)memchr(buf, '\n', len);
+    const char* end = buf + len;
+    while (p && ++p < end) {
+        const char* key = p;
+        const char* colon = (const char*)memchr(p, ':', end - p);
+        if (!colon)
+            break;
+
+        size_t keyLen = colon - key;
+        for (const auto& k : SMAPS_ROLLUP_KEYS) {
+            if (k.len == keyLen && memcmp(k.key, key, keyLen) == 0) {
+                snapshot.*(k.field) = strtoul(colon + 1, NULL, 10);
+                break;
+            }
+        }
+
+        p = (const char*)memchr(colon, '\n', end - colon);
+    }
+
+    return true;
+}
+
+/*
+ * statm is served from mm counters without walking VMAs, so it is cheap
+ * enough to be read for all processes on every tick.
+ */
+bool Proc::getStatmRss(const int pid, unsigned long& rssKb)
+{
+    static const long pageKb = sysconf(_SC_PAGESIZE) / 1024;
+    char path[32];
+    char buf[128];
+    size_t len = 0;
+    int fd = -1;
+
+    snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+    bool ret = preadFile(path, fd, buf, sizeof(buf), len);
+    if (fd >= 0)
+        close(fd);
+    if (!ret || len == 0)
+        return false;
+
+    /* size resident shared text lib data dt, in pages */
+    char* p = NULL;
+    strtoul(buf, &p, 10);
+    rssKb = strtoul(p, NULL, 10) * pageKb;
+    return true;
+}
+
+bool Proc::getOomScoreAdj(const int pid, int& oomScoreAdj)
+{
+    char path[40];
+    char buf[16];
+    size_t len = 0;
+    int fd = -1;
+
+    snprintf(path, sizeof(path), "/proc/%d/oom_score_adj", pid);
+    bool ret = preadFile(path, fd, buf, sizeof(buf), len);
+    if (fd >= 0)
+        close(fd);
+    if (!ret || len == 0)
+        return false;
+
+    oomScoreAdj = atoi(buf);
+    return true;
+}
+
+/* Names of active swap devices, for example "/dev/zram0" */
+bool Proc::getSwapDevices(vector<string>& devices)
+{
+    char buf[4096];
+    size_t len = 0;
+    int fd = -1;
+
+    devices.clear();
+
+    bool ret = preadFile("/proc/swaps", fd, buf, sizeof(buf), len);
+    if (fd >= 0)
+        close(fd);
+    if (!ret)
+        return false;
+
+    /* Skip header line */
+    char* p = strchr(buf, '\n');
+    while (p && *++p != '\0') {
+        char* end = strpbrk(p, " \t\n");
+        if (!end)
+            break;
+
+        devices.push_back(string(p, end - p));
+        p = strchr(end, '\n');
+    }
+
+    return true;
+}
+
+bool Proc::getZramStat(const char* path, int& fd, ZramSnapshot& snapshot)
+{
+    char buf[256];
+    size_t len = 0;
+
+    memset(&snapshot, 0, sizeof(snapshot));
+
+    if (!preadFile(path, fd, buf, sizeof(buf), len))
+        return false;
+
+    int n = sscanf(buf, "%llu %llu %llu %llu %llu %llu %llu %llu",
+                   &snapshot.origDataSize, &snapshot.comprDataSize,
+                   &snapshot.memUsedTotal, &snapshot.memLimit,
+                   &snapshot.memUsedMax, &snapshot.samePages,
+                   &snapshot.pagesCompacted, &snapshot.hugePages);
+
+    /* huge_pages is added since v4.19 */
+    return n >= 7;
+}
+
+/* Sum of disksize of zram devices used as swap */
+bool Proc::getZramDiskSize(unsigned long& diskSizeKb)
+{
+    vector<string> devices;
+    char buf[64];
+    size_t len = 0;
+
+    diskSizeKb = 0;
+
+    if (!getSwapDevices(devices))
+        return false;
+
+    for (const string& dev : devices) {
+        /* /dev/zram0 -> /sys/block/zram0/disksize */
+        string name = dev.substr(dev.rfind('/') + 1);
+        if (name.compare(0, 4, "zram") != 0)
+            continue;
+
+        string path = "/sys/block/" + name + "/disksize";
+        int fd = -1;
+        bool ret = preadFile(path.c_str(), fd, buf, sizeof(buf), len);
+        if (fd >= 0)
+            close(fd);
+        if (ret)
+            diskSizeKb += strtoull(buf, NULL, 10) / 1024;
+    }
+
+    return true;
+}
+
+/*
+ * Read min, low and high watermarks of every zone. They are in pages and
+ * indented under "pages free" of each zone, e.g. "        min      58".
+ */
+bool Proc::getWatermarks(WatermarkSnapshot& snapshot)
+{
+    char line[256];
+    unsigned long pages;
+    char key[16];
+    bool found = false;
+
+    memset(&snapshot, 0, sizeof(snapshot));
+
+    FILE* fp = fopen("/proc/zoneinfo", "re");
+    if (fp == NULL)
+        return false;
+
+    unsigned long pageKb = sysconf(_SC_PAGESIZE) / 1024;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, " %15s %lu", key, &pages) != 2)
+            continue;
+
+        if (strcmp(key, "min") == 0) {
+            snapshot.minKb += pages * pageKb;
+            found = true;
+        } else if (strcmp(key, "low") == 0) {
+            snapshot.lowKb += pages * pageKb;
+        } else if (strcmp(key, "high") == 0) {
+            snapshot.highKb += pages * pageKb;
+        }
+    }
+
+    fclose(fp);
+    return found;
+}
+
+bool Proc::getMinFreeKbytes(unsigned long& minFreeKb)
+{
+    char buf[32];
+    size_t len = 0;
+    int fd = -1;
+
+    minFreeKb = 0;
+
+    bool ret = preadFile("/proc/sys/vm/min_free_kbytes", fd, buf, sizeof(buf), len);
+    if (fd >= 0)
+        close(fd);
+    if (!ret)
+        return false;
+
+    minFreeKb = strtoul(buf, NULL, 10);
+    return true;
+}
+
+/* Board name from device tree, empty on platforms without it */
+bool Proc::getDeviceModel(string& model)
+{
+    char buf[256];
+    size_t len = 0;
+    int fd = -1;
+
+    model.clear();
+
+    bool ret = preadFile("/proc/device-tree/model", fd, buf, sizeof(buf), len);
+    if (fd >= 0)
+        close(fd);
+    if (!ret)
+        return false;
+
+    /* Property is NUL terminated */
+    model = string(buf, strnlen(buf, len));
+    boost::trim(model);
+    return !model.empty();
+}
+
+/*
+ * Apply <advice> (MADV_COLD or MADV_PAGEOUT) to private anonymous VMAs of
+ * <pid> through pidfd and process_madvise. File backed VMAs are left to
+ * the kernel LRU. <advisedKb> is the size kernel accepted, not what is
+ * really reclaimed.
+ */
+bool Proc::adviseAnon(const int pid, const int advice, unsigned long& advisedKb)
+{
+    struct iovec iov[ADVISE_IOV_MAX];
+    char file[32];
+    char line[512];
+    int count = 0;
+    bool ret = true;
+
+    advisedKb = 0;
+
+    int pidfd = syscall(__NR_pidfd_open, pid, 0);
+    if (pidfd < 0)
+        return false;
+
+    snprintf(file, sizeof(file), "/proc/%d/maps", pid);
+    FILE* fp = fopen(file, "re");
+    if (!fp) {
+        close(pidfd);
+        return false;
+    }
+
+    for (bool eof = false; !eof && ret; ) {
+        eof = (fgets(line, sizeof(line), fp) == NULL);
+
+        if (!eof) {
+            unsigned long start, end, inode;
+            char perms[5];
+            int pathPos = 0;
+
+            /* Long pathnames are cut by fgets, rest is not a new line */
+            if (strchr(line, '\n') == NULL) {
+                int c;
+                while ((c = fgetc(fp)) != EOF && c != '\n');
+            }
+
+            if (sscanf(line, "%lx-%lx %4s %*s %*s %lu %n",
+                       &start, &end, perms, &inode, &pathPos) < 4)
+                continue;
+
+            /* Private writable anonymous, including [heap] and [stack] */
+            if (inode != 0 || perms[1] != 'w' || perms[3] != 'p')
+                continue;
+            if (pathPos > 0 && line[pathPos] != '\n' && line[pathPos] != '\0' &&
+                strncmp(line + pathPos, "[heap]", 6) != 0 &&
+                strncmp(line + pathPos, "[stack]", 7) != 0 &&
+                strncmp(line + pathPos, "[anon", 5) != 0)
+                continue;
+
+            iov[count].iov_base = (void*)start;
+            iov[count].iov_len = end - start;
+            count++;
+        }
+
+        if (count == ADVISE_IOV_MAX || (eof && count > 0)) {
+            long advised = syscall(__NR_process_madvise, pidfd, iov, count, advice, 0);
+            if (advised < 0)
+                ret = false;
+            else
+                advisedKb += advised / 1024;
+            count = 0;
+        }
+    }
+
+    fclose(fp);
+    close(pidfd);
+    return ret;
+}
+
 bool Proc::getSmapsRollup(const int pid, map<string, string>& smaps_rollup)
 {
     string file = "/proc/" + to_string(pid) + "/smaps_rollup";
@@ -20,16 +20,130 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <vector>
+
+#include <sys/mman.h>
 
 using namespace std;
 
+/* Advices of Proc::adviseAnon, missing in older headers */
+#ifndef MADV_COLD
+#define MADV_COLD 20
+#endif
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+
+/* Numeric view of /proc/meminfo. All values are in KB as reported by kernel */
+struct MemInfoSnapshot {
+    unsigned long memTotal;
+    unsigned long memFree;
+    unsigned long memAvailable;
+    unsigned long buffers;
+    unsigned long cached;
+    unsigned long swapCached;
+    unsigned long active;
+    unsigned long inactive;
+    unsigned long activeAnon;
+    unsigned long inactiveAnon;
+    unsigned long activeFile;
+    unsigned long inactiveFile;
+    unsigned long swapTotal;
+    unsigned long swapFree;
+    unsigned long dirty;
+    unsigned long anonPages;
+    unsigned long mapped;
+    unsigned long shmem;
+    unsigned long slab;
+    unsigned long sReclaimable;
+    unsigned long sUnreclaim;
+};
+
+/* Numeric view of /proc/pressure/memory. total is in us */
+struct PressureSnapshot {
+    float someAvg10;
+    float someAvg60;
+    float someAvg300;
+    unsigned long long someTotal;
+    float fullAvg10;
+    float fullAvg60;
+    float fullAvg300;
+    unsigned long long fullTotal;
+};
+
+/* Reclaim related counters of /proc/vmstat in pages */
+struct VmStatSnapshot {
+    unsigned long long pgscan;          // pgscan_kswapd + direct + khugepaged
+    unsigned long long pgsteal;         // pgsteal_kswapd + direct + khugepaged
+    unsigned long long refaultAnon;     // workingset_refault_anon
+    unsigned long long refaultFile;     // workingset_refault_file or workingset_refault
+    unsigned long long pswpin;
+    unsigned long long pswpout;
+    unsigned long long allocstall;      // sum of allocstall_*
+};
+
+/* Numeric view of /proc/<pid>/smaps_rollup in KB */
+struct SmapsRollupSnapshot {
+    unsigned long rss;
+    unsigned long pss;
+    unsigned long pssAnon;
+    unsigned long pssFile;
+    unsigned long pssShmem;
+    unsigned long swap;
+    unsigned long swapPss;
+    unsigned long privateClean;
+    unsigned long privateDirty;
+};
+
+/* Numeric view of /sys/block/zram<N>/mm_stat */
+struct ZramSnapshot {
+    unsigned long long origDataSize;    // bytes stored before compression
+    unsigned long long comprDataSize;   // bytes after compression
+    unsigned long long memUsedTotal;    // bytes of RAM used including overhead
+    unsigned long long memLimit;        // bytes, 0 if no limit
+    unsigned long long memUsedMax;
+    unsigned long long samePages;       // pages which are filled with same value
+    unsigned long long pagesCompacted;
+    unsigned long long hugePages;       // incompressible pages
+};
+
+/* Watermarks of all zones in /proc/zoneinfo summed up, in KB */
+struct WatermarkSnapshot {
+    unsigned long minKb;
+    unsigned long lowKb;
+    unsigned long highKb;
+};
+
 class Proc {
 public:
     Proc() {}
     virtual ~Proc() {}
 
     static void getMemInfo(map<string, string>& mInfo);
+    static bool getMemInfo(MemInfoSnapshot& snapshot);
+    static bool getMemPressure(PressureSnapshot& snapshot);
+    static bool getVmStat(VmStatSnapshot& snapshot);
+    static bool getPressure(const char* path, int& fd, PressureSnapshot& snapshot);
     static bool getSmapsRollup(const int pid, map<string, string>& smaps_rollup);
+    static bool getSmapsRollup(const int pid, SmapsRollupSnapshot& snapshot);
+    static bool getStatmRss(const int pid, unsigned long& rssKb);
+    static bool getOomScoreAdj(const int pid, int& oomScoreAdj);
+    static bool getSwapDevices(vector<string>& devices);
+    static bool getZramStat(const char* path, int& fd, ZramSnapshot& snapshot);
+    static bool getZramDiskSize(unsigned long& diskSizeKb);
+    static bool getWatermarks(WatermarkSnapshot& snapshot);
+    static bool getMinFreeKbytes(unsigned long& minFreeKb);
+    static bool getDeviceModel(string& model);
+    static bool adviseAnon(const int pid, const int advice, unsigned long& advisedKb);
+
+    static bool preadFile(const char* path, int& fd, char* buf, size_t size,
+                          size_t& len);
+
+private:
+    /* Kept open per thread, sampler thread may read them with main loop */
+    static thread_local int m_memInfoFd;
+    static thread_local int m_memPressureFd;
+    static thread_local int m_vmStatFd;
 };
 
 #endif /* UTIL_PROC_H_ */
@@ -27,6 +27,15 @@ long Time::getSystemTime()
     return ts.tv_sec;
 }
 
+long long Time::getSystemTimeMs()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+        return 0;
+    }
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 Time::Time()
 {
 }
@@ -20,6 +20,7 @@
 class Time {
 public:
     static long getSystemTime();
+    static long long getSystemTimeMs();
 
     Time();
     virtual ~Time();
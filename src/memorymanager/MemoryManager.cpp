@@ -16,164 +16,296 @@
 
 #include "MemoryManager.h"
 
-#include <chrono>
 #include <map>
-#include <thread>
 
 #include "MMBus.h"
 #include "setting/SettingManager.h"
 #include "util/Logger.h"
 #include "util/Proc.h"
+#include "util/Time.h"
 
-MemoryLevelNormal::MemoryLevelNormal()
+#ifdef SUPPORT_LEGACY_API
+const string MemoryManager::m_oldServiceName = "com.webos.memorymanager";
+#endif
+const string MemoryManager::m_serviceName = "com.webos.service.memorymanager";
+
+void MemoryManager::run()
 {
-    setClassName("MemoryLevelNormal");
+    m_memoryLevels.init();
+
+    m_memoryMonitor = new MemoryMonitor();
+    Logger::normal("MemoryMonitor Initialized", getClassName());
+
+    m_victimScorer = new WeightedVictimScorer();
+
+    m_pssCollector = new PssCollector(SettingManager::getPssWorkers());
+    if (SettingManager::getPssPeriod() > 0)
+        m_memStatSourceId = g_timeout_add(SettingManager::getPssPeriod(),
+                                          onUpdateMemStat, this);
+    Logger::normal("PssCollector Initialized", getClassName());
+
+    if (!SettingManager::getProfilePath().empty())
+        m_launchProfile.open(SettingManager::getProfilePath(), SettingManager::getProfileRecords());
+
+    m_lunaServiceProvider = new LunaServiceProvider();
+    Logger::normal("LunaServiceProvider Initialized", getClassName());
+
+    m_sessionMonitor = new SessionMonitor();
+    Logger::normal("SessionMonitor Initialized", getClassName());
+
+    Logger::normal("Start mainLoop", getClassName());
+    g_main_loop_run(m_mainLoop);
 }
 
-string MemoryLevelNormal::toString()
+/*
+ * Keeps memory usage of processes fresh for victim selection. Processes of
+ * all sessions are collected at once. RSS is read right away and PSS
+ * refinement is not waited, it is picked up next time.
+ */
+gboolean MemoryManager::onUpdateMemStat(gpointer data)
 {
-    return "normal";
+    MemoryManager* mm = static_cast<MemoryManager*>(data);
+    vector<int> pids;
+
+    auto sessions = mm->m_sessionMonitor->getSessions();
+    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it)
+        it->second->m_runtime->getPids(pids);
+
+    mm->m_pssCollector->collect(pids, 0);
+
+    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it)
+        it->second->m_runtime->updateMemStat();
+
+    return G_SOURCE_CONTINUE;
 }
 
-bool MemoryLevelNormal::keepLevel(long memAvail)
+void MemoryManager::handleMemoryMonitorEvent(MonitorEvent& event)
 {
-    if (memAvail > SettingManager::getMemoryLevelLowEnter())
-        return true;
-    else
-        return false;
+    if (typeid(event) == typeid(AvailMemMonitor)) {
+        AvailMemMonitor& m = static_cast<AvailMemMonitor&>(event);
+        updateMemoryLevel(getEffectiveAvailable(m.getAvailable()));
+        predictMemoryLevel(m.getTrend().getTimeToReach(SettingManager::getMemoryLevelCriticalEnter()));
+        recordHistory(m);
+        if (!m_memoryRequests.empty())
+            progressMemoryRequests();
+    } else if (typeid(event) == typeid(PsiMonitor)) {
+        handlePsiEvent(static_cast<PsiMonitor&>(event));
+    } else if (typeid(event) == typeid(MemcgMonitor)) {
+        handleMemcgEvent(static_cast<MemcgMonitor&>(event));
+    } else if (typeid(event) == typeid(SamplerMonitor)) {
+        handleSamplerEvent(static_cast<SamplerMonitor&>(event));
+    } else if (typeid(event) == typeid(CgroupMonitor)) {
+        handleCgroupEvent(static_cast<CgroupMonitor&>(event));
+    } else if (typeid(event) == typeid(VmStatMonitor)) {
+        handleVmStatEvent(static_cast<VmStatMonitor&>(event));
+    } else if (typeid(event) == typeid(SwapMonitor)) {
+        handleSwapEvent(static_cast<SwapMonitor&>(event));
+    }
 }
 
-void MemoryLevelNormal::action(string& errorText)
+/* KB to be freed to get back to <exitLevel> MB */
+unsigned long MemoryManager::getReclaimTarget(int exitLevel)
 {
+    MemInfoSnapshot mInfo;
+
+    if (!Proc::getMemInfo(mInfo))
+        return 0;
 
+    long available = getEffectiveAvailable(mInfo.memAvailable / 1024);
+    return (available < exitLevel) ? (unsigned long)(exitLevel - available) * 1024 : 0;
 }
 
-MemoryLevelLow::MemoryLevelLow()
+void MemoryManager::setVictimScorer(VictimScorer* scorer)
 {
-    setClassName("MemoryLevelLow");
+    if (!scorer || scorer == m_victimScorer)
+        return;
+
+    delete m_victimScorer;
+    m_victimScorer = scorer;
 }
 
-string MemoryLevelLow::toString()
+long MemoryManager::getEffectiveAvailable(long memAvail)
 {
-    return "low";
+    SwapMonitor* swap = m_memoryMonitor ? m_memoryMonitor->getSwapMonitor() : nullptr;
+
+    if (!swap || !SettingManager::getSwapEffective())
+        return memAvail;
+
+    return swap->getEffectiveAvailable(memAvail);
 }
 
-bool MemoryLevelLow::keepLevel(long memAvail)
+/* Anon pages cannot be reclaimed anymore once zram is full */
+void MemoryManager::handleSwapEvent(SwapMonitor& event)
 {
-    if (memAvail < SettingManager::getMemoryLevelLowExit() &&
-            memAvail > SettingManager::getMemoryLevelCriticalEnter())
-        return true;
-    else
-        return false;
+    string errorText = "";
+
+    if (!isReady())
+        return;
+
+    Logger::normal("Swap full " + to_string(event.isFull()) +
+                   ", ratio " + to_string(event.getRatio()), getClassName());
+
+    if (event.isFull() && m_memoryLevels.getCurrent().getAction() < LevelAction::LOW)
+        MemoryLevel::runAction(LevelAction::LOW, SettingManager::getMemoryLevelLowExit(), errorText);
 }
 
-void MemoryLevelLow::action(string& errorText)
+/*
+ * With zram, MemAvailable may look fine while reclaimed pages are refaulted
+ * right away. Reclaim by thrashing score in addition to MemAvailable.
+ */
+void MemoryManager::handleVmStatEvent(VmStatMonitor& event)
 {
-    MemoryManager* mm = MemoryManager::getInstance();
-    auto sessions = mm->getSessionMonitor().getSessions();
-    int allAppCount = 0;
-
-    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it) {
-        it->second->m_runtime->reclaimMemory(false);
-        allAppCount += it->second->m_runtime->countApp();
-    }
+    int score = event.getThrashingScore();
+    string errorText = "";
 
-    if (allAppCount == 0) {
-        errorText = "Failed to reclaim required memory. All apps were closed";
+    LevelAction current = m_memoryLevels.getCurrent().getAction();
+
+    if (score >= SettingManager::getThrashingCritical() && current < LevelAction::CRITICAL) {
+        Logger::normal("Thrashing score " + to_string(score) + ", reclaim as critical",
+                       getClassName());
+        MemoryLevel::runAction(LevelAction::CRITICAL,
+                               SettingManager::getMemoryLevelCriticalExit(), errorText);
+    } else if (score >= SettingManager::getThrashingLow() && current < LevelAction::LOW) {
+        Logger::normal("Thrashing score " + to_string(score) + ", reclaim as low",
+                       getClassName());
+        MemoryLevel::runAction(LevelAction::LOW, SettingManager::getMemoryLevelLowExit(), errorText);
     }
 }
 
-MemoryLevelCritical::MemoryLevelCritical()
+void MemoryManager::handleSamplerEvent(SamplerMonitor& event)
 {
-    setClassName("MemoryLevelCritical");
+    const SamplerEvent& e = event.getEvent();
+
+    /* Sampler thread already recorded history */
+    updateMemoryLevel(e.available);
+    predictMemoryLevel(e.timeToCritical);
+
+    if (e.stall >= 0)
+        handleStall((PsiMonitor::Stall)e.stall);
+
+    if (!m_memoryRequests.empty())
+        progressMemoryRequests();
 }
 
-string MemoryLevelCritical::toString()
+void MemoryManager::handleMemcgEvent(MemcgMonitor& event)
 {
-    return "critical";
+    Session& session = event.getSession();
+    const MemcgEvents& delta = event.getDelta();
+
+    /* Reach memory.max or OOM in this session, close even foreground app */
+    bool critical = (delta.max > 0 || delta.oom > 0 || delta.oomKill > 0);
+
+    Logger::normal("Memcg event in session " + session.getSessionId() +
+                   ": pressure " + to_string(event.isPressured()) +
+                   ", high " + to_string(delta.high) +
+                   ", max " + to_string(delta.max) +
+                   ", oom " + to_string(delta.oom) +
+                   ", oom_kill " + to_string(delta.oomKill), getClassName());
+
+    session.m_runtime->reclaimMemory(critical);
 }
 
-bool MemoryLevelCritical::keepLevel(long memAvail)
+void MemoryManager::handleCgroupEvent(CgroupMonitor& event)
 {
-    if (memAvail < SettingManager::getMemoryLevelCriticalExit())
-        return true;
-    else
-        return false;
+    Session& session = event.getSession();
+
+    session.m_runtime->syncService();
+    Logger::verbose("Services are synced in session " + session.getSessionId() +
+                    ": " + to_string(session.m_runtime->countService()), getClassName());
 }
 
-void MemoryLevelCritical::action(string& errorText)
+void MemoryManager::handlePsiEvent(PsiMonitor& event)
 {
-    MemoryManager* mm = MemoryManager::getInstance();
-    auto sessions = mm->getSessionMonitor().getSessions();
-    int allAppCount = 0;
+    const PressureSnapshot& pressure = event.getPressure();
+    MemInfoSnapshot mInfo;
 
-    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it) {
-        it->second->m_runtime->reclaimMemory(true);
-        allAppCount += it->second->m_runtime->countApp();
-    }
+    Logger::normal("PSI " + string(event.getStall() == PsiMonitor::Stall::FULL ? "full" : "some") +
+                   " trigger: some avg10 " + to_string(pressure.someAvg10) +
+                   ", full avg10 " + to_string(pressure.fullAvg10), getClassName());
 
-    if (allAppCount == 0) {
-        errorText = "Failed to reclaim required memory. All apps were closed";
-    }
+    /* Do not wait for next meminfo polling */
+    if (Proc::getMemInfo(mInfo))
+        updateMemoryLevel(getEffectiveAvailable(mInfo.memAvailable / 1024));
 
+    handleStall(event.getStall());
 }
 
-#ifdef SUPPORT_LEGACY_API
-const string MemoryManager::m_oldServiceName = "com.webos.memorymanager";
-#endif
-const string MemoryManager::m_serviceName = "com.webos.service.memorymanager";
+void MemoryManager::handleStall(PsiMonitor::Stall stall)
+{
+    string errorText = "";
 
-void MemoryManager::run()
+    /* All non-idle tasks are stalled, reclaim as critical regardless of level */
+    if (stall == PsiMonitor::Stall::FULL &&
+        m_memoryLevels.getCurrent().getAction() < LevelAction::CRITICAL)
+        MemoryLevel::runAction(LevelAction::CRITICAL,
+                               SettingManager::getMemoryLevelCriticalExit(), errorText);
+}
+
+/*
+ * MemoryLevel is changed after threshold is crossed. If available memory is
+ * falling fast enough to reach critical level within horizon, start reclaim
+ * of low level in advance.
+ */
+void MemoryManager::predictMemoryLevel(long timeToCritical)
 {
-    m_memoryLevel = new MemoryLevelNormal;
+    string errorText = "";
+    long horizon = SettingManager::getPredictionHorizon();
 
-    m_memoryMonitor = new MemoryMonitor();
-    Logger::normal("MemoryMonitor Initialized", getClassName());
+    if (horizon <= 0 || m_memoryLevels.getCurrent().getAction() >= LevelAction::LOW)
+        return;
 
-    m_lunaServiceProvider = new LunaServiceProvider();
-    Logger::normal("LunaServiceProvider Initialized", getClassName());
+    if (timeToCritical < 0 || timeToCritical > horizon)
+        return;
 
-    m_sessionMonitor = new SessionMonitor();
-    Logger::normal("SessionMonitor Initialized", getClassName());
+    /* Projection holds for many samples, reclaim once per action period */
+    if (!m_memoryLevels.claimAction())
+        return;
 
-    Logger::normal("Start mainLoop", getClassName());
-    g_main_loop_run(m_mainLoop);
+    Logger::normal("Critical level is expected in " + to_string(timeToCritical) +
+                   "ms, reclaim in advance", getClassName());
+
+    MemoryLevel::runAction(LevelAction::LOW, SettingManager::getMemoryLevelLowExit(), errorText);
 }
 
-void MemoryManager::handleMemoryMonitorEvent(MonitorEvent& event)
+void MemoryManager::recordHistory(AvailMemMonitor& monitor)
 {
-    MemoryLevel *prev;
-    long memAvail;
-    string errorText = "";
+    MemorySample sample;
+    PressureSnapshot pressure;
 
-    // Currently we use AvailMemMonitor only
-    if (typeid(event) != typeid(AvailMemMonitor))
-        return;
+    if (!Proc::getMemPressure(pressure))
+        pressure.someAvg10 = pressure.fullAvg10 = 0;
 
-    AvailMemMonitor& m = static_cast<AvailMemMonitor&>(event);
-    memAvail = m.getAvailable();
+    sample.time = Time::getSystemTimeMs();
+    sample.total = monitor.getTotal();
+    sample.available = monitor.getAvailable();
+    sample.swapUsed = monitor.getSwapUsed();
+    sample.psiSomeAvg10 = pressure.someAvg10;
+    sample.psiFullAvg10 = pressure.fullAvg10;
+    snprintf(sample.level, sizeof(sample.level), "%s", m_memoryLevels.getCurrent().toString().c_str());
 
-    /* MemoryLevel changed */
-    if (!m_memoryLevel->keepLevel(memAvail)) {
-        prev = m_memoryLevel;
+    m_memoryHistory.push(sample);
+}
+
+void MemoryManager::updateMemoryLevel(long memAvail)
+{
+    string errorText = "";
 
-        if (memAvail < SettingManager::getMemoryLevelCriticalEnter())
-            m_memoryLevel = new MemoryLevelCritical;
-        else if (memAvail < SettingManager::getMemoryLevelLowEnter())
-            m_memoryLevel = new MemoryLevelLow;
-        else
-            m_memoryLevel = new MemoryLevelNormal;
+    /* MemoryLevel changed */
+    const MemoryLevel* prev = m_memoryLevels.update(memAvail);
+    if (prev) {
+        const MemoryLevel& cur = m_memoryLevels.getCurrent();
 
         Logger::normal("MemoryLevel changed from " + prev->toString() +
-                "to " + m_memoryLevel->toString(), getClassName());
+                " to " + cur.toString(), getClassName());
 
         m_lunaServiceProvider->postMemoryStatus();
-        m_lunaServiceProvider->raiseSignalLevelChanged(prev->toString(), m_memoryLevel->toString());
-
-        delete prev;
+        m_lunaServiceProvider->raiseSignalLevelChanged(prev->toString(), cur.toString());
     }
 
-    m_memoryLevel->action(errorText);
+    /* Let previous reclaim settle before running it again */
+    const MemoryLevel& level = m_memoryLevels.getCurrent();
+    if (level.getAction() != LevelAction::NONE && m_memoryLevels.claimAction())
+        level.action(errorText);
 }
 
 void MemoryManager::print(JValue& printOut)
@@ -181,24 +313,19 @@ void MemoryManager::print(JValue& printOut)
     int total = 0, available = 0;
 
     /* Get Meminfo */
-    map<string, string> mInfo;
-    Proc::getMemInfo(mInfo);
-
-    auto it = mInfo.find("MemTotal");
-    if (it != mInfo.end()) {
-        total = stoi(it->second) / 1024;
-    }
-
-    it = mInfo.find("MemAvailable");
-    if (it != mInfo.end()) {
-        available = stoi(it->second) / 1024;
+    MemInfoSnapshot mInfo;
+    if (Proc::getMemInfo(mInfo)) {
+        total = mInfo.memTotal / 1024;
+        available = mInfo.memAvailable / 1024;
     }
 
     /* Organize "system" */
     JValue current = pbnjson::Object();
-    current.put("level", m_memoryLevel->toString());
+    current.put("level", m_memoryLevels.getCurrent().toString());
     current.put("total", total);
     current.put("available", available);
+    if (m_memoryMonitor)
+        m_memoryMonitor->print(current);
     printOut.put("system", current);
 
     /* Organize "threshold" */
@@ -214,18 +341,73 @@ void MemoryManager::print(JValue& printOut)
 
     threshold.put("low", low);
     threshold.put("critical", critical);
+
+    JValue levels = pbnjson::Array();
+    for (int i = 0; i < SettingManager::getMemoryLevelCount(); ++i) {
+        const MemoryLevelSetting& setting = SettingManager::getMemoryLevel(i);
+        JValue level = pbnjson::Object();
+        level.put("name", setting.name);
+        level.put("enter", setting.enter);
+        level.put("exit", setting.exit);
+        level.put("dwell", setting.dwell);
+        level.put("action", setting.action);
+        levels.append(level);
+    }
+    threshold.put("levels", levels);
+    threshold.put("source", SettingManager::getMemoryLevelSource());
     printOut.put("threshold", threshold);
 
-    /* Organize "applications" */
+    /* Organize "admission" */
+    JValue admission = pbnjson::Object();
+    admission.put("reserved", getReservedMemory());
+    admission.put("reservations", (int)m_reservations.size());
+    admission.put("waiting", (int)m_memoryRequests.size());
+    printOut.put("admission", admission);
+
+    /* Organize "sessions" */
+    JValue sessionList = pbnjson::Array();
+    auto sessions = m_sessionMonitor->getSessions();
+    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it) {
+        JValue obj = pbnjson::Object();
+        it->second->print(obj);
+        sessionList.append(obj);
+    }
+    printOut.put("sessions", sessionList);
+
+    /* Organize "applications", memory usage is the one of last onUpdateMemStat */
     JValue apps = pbnjson::Array();
     printOut.put("applications", apps);
-    auto sessions = m_sessionMonitor->getSessions();
     for (auto it = sessions.cbegin(); it != sessions.cend(); ++it) {
         if (it->second->m_runtime->countApp() > 0)
             it->second->m_runtime->printApp(apps);
     }
 }
 
+void MemoryManager::printHistory(JValue& printOut, int count)
+{
+    static MemorySample samples[MemoryHistory::CAPACITY];
+    long long now = Time::getSystemTimeMs();
+
+    if (count <= 0 || count > MemoryHistory::CAPACITY)
+        count = MemoryHistory::CAPACITY;
+
+    int n = m_memoryHistory.read(samples, count);
+
+    JValue history = pbnjson::Array();
+    for (int i = 0; i < n; ++i) {
+        JValue sample = pbnjson::Object();
+        sample.put("age", (int64_t)(now - samples[i].time));
+        sample.put("level", samples[i].level);
+        sample.put("total", (int64_t)samples[i].total);
+        sample.put("available", (int64_t)samples[i].available);
+        sample.put("swapUsed", (int64_t)samples[i].swapUsed);
+        sample.put("psiSome", (double)samples[i].psiSomeAvg10);
+        sample.put("psiFull", (double)samples[i].psiFullAvg10);
+        history.append(sample);
+    }
+    printOut.put("history", history);
+}
+
 void MemoryManager::handleRuntimeChange(const string& appId, const string& instanceId,
                                         const enum RuntimeChange& change)
 {
@@ -252,60 +434,245 @@ bool MemoryManager::onMemoryPressured(MMBusComWebosMemoryManager1 *object, guint
         if (allAppCount == 0) {
             Logger::normal("Failed to reclaim required memory. No more app to be closed");
         }
-    } else if (var == type_swap) {// we will ignore TYPE_SWAP now
+    } else if (var == type_swap) {
+        MemoryManager* self = MemoryManager::getInstance();
+        SwapMonitor* swap = self->getMemoryMonitor().getSwapMonitor();
+
         Logger::normal("Received SWAP Pressure");
+
+        /* Do not wait for next polling. Full state change raises event */
+        if (swap)
+            swap->update();
     }
 
     return true;
 }
 
-bool MemoryManager::onRequireMemory(const int requiredMemory, string& errorText)
+/* Whether <requested> MB fits in available memory not reserved yet */
+bool MemoryManager::isRequestFit(int requested)
 {
-    MemoryLevel *level = NULL;
-    map<string, string> mInfo;
-    int i, requested;
-    bool ret = false;
+    MemInfoSnapshot mInfo;
+    long available = 0;
+
+    /* Same swap aware view as memory levels */
+    if (Proc::getMemInfo(mInfo))
+        available = getEffectiveAvailable(mInfo.memAvailable / 1024);
+
+    available -= getReservedMemory();
+    return available - requested > SettingManager::getMemoryLevelCriticalEnter();
+}
+
+int MemoryManager::getReservedMemory()
+{
+    int reserved = 0;
+
+    for (const Reservation& r : m_reservations)
+        reserved += r.size;
+    return reserved;
+}
+
+void MemoryManager::grantMemoryRequest(MemoryRequest& req)
+{
+    Reservation r;
+
+    r.appId = req.appId;
+    r.size = req.requested;
+    r.expire = Time::getSystemTimeMs() + SettingManager::getAdmissionLease();
+    m_reservations.push_back(r);
+
+    m_lunaServiceProvider->respondRequireMemory(req.message, true, "");
+}
+
+/*
+ * Called when an app is running. Releases the reservation bound to it,
+ * reservations without appId can't be matched and expire by their lease.
+ */
+void MemoryManager::releaseReservation(const string& appId)
+{
+    if (appId.empty())
+        return;
+
+    auto found = m_reservations.begin();
+    while (found != m_reservations.end() && found->appId != appId)
+        ++found;
+
+    if (found == m_reservations.end())
+        return;
+
+    m_reservations.erase(found);
+    if (!m_memoryRequests.empty())
+        progressMemoryRequests();
+}
+
+void MemoryManager::expireReservations()
+{
+    long long now = Time::getSystemTimeMs();
 
+    for (auto it = m_reservations.begin(); it != m_reservations.end(); ) {
+        if (now < it->expire) {
+            ++it;
+            continue;
+        }
+        Logger::normal("Reservation of " + to_string(it->size) + " MB for '" +
+                       it->appId + "' expired", getClassName());
+        it = m_reservations.erase(it);
+    }
+}
+
+void MemoryManager::onRequireMemory(const int requiredMemory, const string& appId,
+                                    const int priority, Message& request)
+{
     if (SettingManager::getSingleAppPolicy()) {
         Logger::normal("SingleAppPolicy, Skip memory level check", getClassName());
-        return true;
+        m_lunaServiceProvider->respondRequireMemory(request, true, "");
+        return;
     }
 
-    if (requiredMemory <= 0)
-        requested = m_defaultRequiredMemory;
-    else
-        requested = requiredMemory;
+    MemoryRequest req;
+    req.message = request;
+    req.appId = appId;
+    req.priority = priority;
+    req.requested = (requiredMemory <= 0) ? m_defaultRequiredMemory : requiredMemory;
+
+    /* Learned footprint replaces the default and raises an under-estimate */
+    unsigned long peakKb = 0;
+    if (!appId.empty() && m_launchProfile.getPeak(appId, peakKb)) {
+        int learned = (int)((peakKb + 1023) / 1024);
+        if (requiredMemory <= 0 || learned > req.requested)
+            req.requested = learned;
+    }
+    req.state = RequestState::NEW;
+    req.retry = 0;
+    req.nextTime = 0;
 
-    /* Get Meminfo */
-    Proc::getMemInfo(mInfo);
-    auto it = mInfo.find("MemAvailable");
-    long available = 0;
-    if (it != mInfo.end()) {
-        available = stol(it->second) / 1024;
+    expireReservations();
+
+    /* Nobody is waiting, admit at once if it fits */
+    if (m_memoryRequests.empty() && isRequestFit(req.requested)) {
+        grantMemoryRequest(req);
+        return;
     }
 
-    if (available - requested > SettingManager::getMemoryLevelCriticalEnter())
-        return true;
+    /* After requests of same or higher priority */
+    auto pos = m_memoryRequests.begin();
+    while (pos != m_memoryRequests.end() && pos->priority >= priority)
+        ++pos;
+    m_memoryRequests.insert(pos, req);
+
+    Logger::normal("Queued " + to_string(req.requested) + " MB for '" + appId + "', " +
+                   to_string(m_memoryRequests.size()) + " waiting, " +
+                   to_string(getReservedMemory()) + " MB reserved", getClassName());
+
+    if (!m_memoryRequestSourceId)
+        m_memoryRequestSourceId = g_timeout_add(m_requestPeriod, onMemoryRequestTimer, this);
 
-    level = new MemoryLevelCritical;
-    for (i = 0; i < m_retryCount; ++i) {
-        level->action(errorText);
-        /* TODO : wait progess... */
-        this_thread::sleep_for(chrono::milliseconds(200));
+    progressMemoryRequests();
+}
+
+gboolean MemoryManager::onMemoryRequestTimer(gpointer data)
+{
+    MemoryManager* self = static_cast<MemoryManager*>(data);
+
+    self->progressMemoryRequests();
+    if (!self->m_memoryRequests.empty())
+        return G_SOURCE_CONTINUE;
+
+    self->m_memoryRequestSourceId = 0;
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Admit requests in queue order while they fit. Only the head closes apps
+ * for its deficit, so that later requests never overtake or double-book
+ * memory freed for it.
+ */
+void MemoryManager::progressMemoryRequests()
+{
+    expireReservations();
 
-        /* Get Meminfo */
-        Proc::getMemInfo(mInfo);
-        it = mInfo.find("MemAvailable");
-        if (it != mInfo.end()) {
-            available = stol(it->second) / 1024;
+    while (!m_memoryRequests.empty()) {
+        MemoryRequest& req = m_memoryRequests.front();
+        long long now = Time::getSystemTimeMs();
+
+        if (isRequestFit(req.requested)) {
+            grantMemoryRequest(req);
+            m_memoryRequests.pop_front();
+            continue;
         }
 
-        if (available - requested > SettingManager::getMemoryLevelCriticalEnter()) {
-            ret = true;
+        if (now < req.nextTime)
             break;
+
+        if (req.state == RequestState::NEW) {
+            MemInfoSnapshot mInfo;
+            long available = 0;
+
+            if (Proc::getMemInfo(mInfo))
+                available = mInfo.memAvailable / 1024;
+
+            /* Close planned victims at once and wait for them once */
+            long deficit = req.requested + getReservedMemory() +
+                           SettingManager::getMemoryLevelCriticalEnter() - available + 1;
+            if (closePlannedVictims((unsigned long)deficit * 1024)) {
+                req.state = RequestState::PLANNED;
+                req.nextTime = now + SettingManager::getPlannerSettle();
+                break;
+            }
+            req.state = RequestState::RETRY;
+        } else if (req.state == RequestState::PLANNED) {
+            Logger::normal("Planned victims are not enough for " +
+                           to_string(req.requested) + " MB", getClassName());
+            req.state = RequestState::RETRY;
         }
+
+        /* Fall back to close one by one, including foreground apps */
+        if (req.retry >= m_retryCount) {
+            m_lunaServiceProvider->respondRequireMemory(req.message, false, req.errorText);
+            m_memoryRequests.pop_front();
+            continue;
+        }
+
+        req.errorText = "";
+        MemoryLevel::runAction(LevelAction::CRITICAL,
+                               SettingManager::getMemoryLevelCriticalExit(), req.errorText);
+        req.retry++;
+        req.nextTime = now + m_retryInterval;
+        break;
     }
-    delete level;
+}
+
+/* Returns true if any planned victim is closed */
+bool MemoryManager::closePlannedVictims(unsigned long deficitKb)
+{
+    vector<VictimCandidate> candidates, victims;
+    SwapMonitor* swap = m_memoryMonitor->getSwapMonitor();
+    float swapRatio = (swap && swap->isZram()) ? swap->getRatio() : 0.0f;
+    bool ret = false;
+
+    auto sessions = m_sessionMonitor->getSessions();
+    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it)
+        it->second->m_runtime->getVictimCandidates(false, candidates);
+
+    if (candidates.empty())
+        return false;
+
+    m_victimScorer->score(candidates);
+    m_victimPlanner.plan(candidates, deficitKb, swapRatio, victims);
+
+    /* Copy ids first, closing may change application list */
+    vector<pair<Runtime*, pair<string, string>>> ids;
+    for (const VictimCandidate& v : victims) {
+        Logger::normal("Planned victim " + v.app->getAppId() + " freeable " +
+                       to_string(VictimPlanner::getFreeable(v, swapRatio)) + " kb",
+                       getClassName());
+        ids.push_back(make_pair(v.runtime, make_pair(v.app->getAppId(), v.app->getInstanceId())));
+    }
+
+    for (const auto& id : ids) {
+        if (id.first->closeApp(id.second.first, id.second.second))
+            ret = true;
+    }
+
     return ret;
 }
 
@@ -348,8 +715,11 @@ MemoryManager::MemoryManager()
 
     m_mainLoop = g_main_loop_new(NULL, FALSE);
 
-    m_memoryLevel = nullptr;
     m_memoryMonitor = nullptr;
+    m_pssCollector = nullptr;
+    m_victimScorer = nullptr;
+    m_memStatSourceId = 0;
+    m_memoryRequestSourceId = 0;
     m_sessionMonitor = nullptr;
     m_lunaServiceProvider = nullptr;
 
@@ -363,5 +733,11 @@ MemoryManager::~MemoryManager()
 
     g_object_unref(m_proxy);
     delete m_memoryMonitor;
+    if (m_memStatSourceId)
+        g_source_remove(m_memStatSourceId);
+    if (m_memoryRequestSourceId)
+        g_source_remove(m_memoryRequestSourceId);
+    delete m_pssCollector;
+    delete m_victimScorer;
     delete m_lunaServiceProvider;
 }
@@ -23,8 +23,13 @@
 
 #include "MMBus.h"
 #include "memorymonitor/MemoryMonitor.h"
+#include "memorymonitor/MemoryHistory.h"
+#include "memorymonitor/SamplerMonitor.h"
 #include "luna2/LunaConnector.h"
+#include "base/LaunchProfile.h"
+#include "base/MemoryLevel.h"
 #include "base/Runtime.h"
+#include "base/VictimPlanner.h"
 #include "session/Session.h"
 
 #include "interface/IClassName.h"
@@ -36,48 +41,6 @@ using namespace pbnjson;
 
 class MemroyManager;
 
-class MemoryLevel : public IClassName {
-public:
-    explicit MemoryLevel() = default;
-    virtual ~MemoryLevel() {}
-
-    virtual string toString() = 0;
-    virtual void action(string& errorText) = 0;
-    virtual bool keepLevel(long memAvail) = 0;
-
-private:
-};
-
-class MemoryLevelNormal : public MemoryLevel {
-public:
-    explicit MemoryLevelNormal();
-    virtual ~MemoryLevelNormal() {}
-
-    virtual string toString() override final;
-    virtual void action(string& errorText) override final;
-    virtual bool keepLevel(long memAvail) override final;
-};
-
-class MemoryLevelLow : public MemoryLevel {
-public:
-    explicit MemoryLevelLow();
-    virtual ~MemoryLevelLow() {}
-
-    virtual string toString() override final;
-    virtual void action(string& errorText) override final;
-    virtual bool keepLevel(long memAvail) override final;
-};
-
-class MemoryLevelCritical : public MemoryLevel {
-public:
-    explicit MemoryLevelCritical();
-    virtual ~MemoryLevelCritical() {}
-
-    virtual string toString() override final;
-    virtual void action(string& errorText) override final;
-    virtual bool keepLevel(long memAvail) override final;
-};
-
 class MemoryManager : public ISingleton<MemoryManager>,
                       public IClassName,
                       public IPrintable {
@@ -92,6 +55,15 @@ public:
     const string& getServiceName() const { return m_serviceName; }
     GMainLoop* getMainLoop() const { return m_mainLoop; }
     SessionMonitor& getSessionMonitor() const { return *m_sessionMonitor; }
+    MemoryMonitor& getMemoryMonitor() const { return *m_memoryMonitor; }
+    MemoryHistory& getMemoryHistory() { return m_memoryHistory; }
+    PssCollector& getPssCollector() const { return *m_pssCollector; }
+    VictimScorer& getVictimScorer() const { return *m_victimScorer; }
+    LaunchProfile& getLaunchProfile() { return m_launchProfile; }
+    void setVictimScorer(VictimScorer* scorer);
+
+    /* False while monitors are being created in run() */
+    bool isReady() const { return m_memoryMonitor && m_sessionMonitor; }
 
     /* Handle insternal events */
     void handleMemoryMonitorEvent(MonitorEvent& event);
@@ -99,11 +71,17 @@ public:
                              const enum RuntimeChange& change);
 
     /* for exposed APIs used by LunaServiceProvider */
-    bool onRequireMemory(const int requiredMemory, string& errorText);
+    void onRequireMemory(const int requiredMemory, const string& appId,
+                         const int priority, Message& request);
+    void releaseReservation(const string& appId);
+
+    long getEffectiveAvailable(long memAvail);
+    unsigned long getReclaimTarget(int exitLevel);
 
     // IPrintable
     virtual void print() override final {};
     virtual void print(JValue& printOut) override final;
+    void printHistory(JValue& printOut, int count);
 
     // DBus
     bool registerSignal();
@@ -111,13 +89,76 @@ public:
 private:
     static const int m_defaultRequiredMemory = 120;
     static const int m_retryCount = 20;
+    static const int m_retryInterval = 200;     // ms between critical actions
+    static const int m_requestPeriod = 100;     // ms to check memory of requests
+
+    /*
+     * requireMemory waiting for memory, queued in priority order. The head
+     * closes planned victims (NEW), waits for them (PLANNED) and then
+     * closes apps one by one (RETRY), replied from timer or monitor events
+     * instead of sleeping on the main loop.
+     */
+    enum class RequestState : char {
+        NEW = 0,
+        PLANNED,
+        RETRY,
+    };
+    struct MemoryRequest {
+        Message message;
+        string appId;               // app to be launched, empty if unknown
+        int priority;               // higher is admitted first
+        int requested;              // MB
+        RequestState state;
+        int retry;
+        long long nextTime;         // ms monotonic of next state change or action
+        string errorText;
+    };
+
+    /*
+     * Memory granted to a launch, counted against available memory until
+     * the app runs (SAM::onRunning) or the lease expires
+     */
+    struct Reservation {
+        string appId;
+        int size;                   // MB
+        long long expire;           // ms monotonic
+    };
 
     static bool onMemoryPressured(MMBusComWebosMemoryManager1 *object, guint var);
+    static gboolean onUpdateMemStat(gpointer data);
+    static gboolean onMemoryRequestTimer(gpointer data);
+
+    bool isRequestFit(int requested);
+    void grantMemoryRequest(MemoryRequest& req);
+    void expireReservations();
+    int getReservedMemory();
+    void progressMemoryRequests();
+
+    void handlePsiEvent(PsiMonitor& event);
+    void handleMemcgEvent(MemcgMonitor& event);
+    void handleCgroupEvent(CgroupMonitor& event);
+    void handleSamplerEvent(SamplerMonitor& event);
+    void handleVmStatEvent(VmStatMonitor& event);
+    void handleSwapEvent(SwapMonitor& event);
+    bool closePlannedVictims(unsigned long deficitKb);
+    void handleStall(PsiMonitor::Stall stall);
+    void updateMemoryLevel(long memAvail);
+    void predictMemoryLevel(long timeToCritical);
+    void recordHistory(AvailMemMonitor& monitor);
 
     LunaServiceProvider* m_lunaServiceProvider;
     GMainLoop* m_mainLoop;
-    MemoryLevel* m_memoryLevel;
+    MemoryLevelTable m_memoryLevels;
     MemoryMonitor* m_memoryMonitor;
+    MemoryHistory m_memoryHistory;
+    PssCollector* m_pssCollector;
+    VictimScorer* m_victimScorer;
+    VictimPlanner m_victimPlanner;
+    LaunchProfile m_launchProfile;
+    guint m_memStatSourceId;
+    list<MemoryRequest> m_memoryRequests;
+    list<Reservation> m_reservations;
+    guint m_memoryRequestSourceId;
 #ifdef SUPPORT_LEGACY_API
     static const string m_oldServiceName;
 #endif
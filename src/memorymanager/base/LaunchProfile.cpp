@@ -0,0 +1,176 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "base/LaunchProfile.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "util/Logger.h"
+
+LaunchProfile::LaunchProfile()
+    : m_header(nullptr),
+      m_records(nullptr),
+      m_size(0)
+{
+    setClassName("LaunchProfile");
+}
+
+LaunchProfile::~LaunchProfile()
+{
+    close();
+}
+
+/* Map <path>, creating it with <capacity> records if missing or invalid */
+bool LaunchProfile::open(const string& path, int capacity)
+{
+    close();
+
+    if (capacity <= 0)
+        return false;
+
+    /* Parent directory may not exist at first boot */
+    size_t slash = path.rfind('/');
+    if (slash != string::npos && slash > 0)
+        mkdir(path.substr(0, slash).c_str(), 0700);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        Logger::warning("Failed to open " + path, getClassName());
+        return false;
+    }
+
+    size_t size = sizeof(Header) + sizeof(Record) * capacity;
+    struct stat st;
+    bool valid = false;
+
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size == size) {
+        Header header;
+        if (pread(fd, &header, sizeof(header), 0) == sizeof(header))
+            valid = (header.magic == MAGIC && header.version == VERSION &&
+                     header.recordSize == sizeof(Record) &&
+                     header.capacity == (uint32_t)capacity);
+    }
+
+    /* Start over if the file is from another layout */
+    if (!valid && (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0)) {
+        Logger::warning("Failed to resize " + path, getClassName());
+        ::close(fd);
+        return false;
+    }
+
+    void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        Logger::warning("Failed to map " + path, getClassName());
+        return false;
+    }
+
+    m_size = size;
+    m_header = static_cast<Header*>(addr);
+    m_records = reinterpret_cast<Record*>(m_header + 1);
+
+    if (!valid) {
+        m_header->magic = MAGIC;
+        m_header->version = VERSION;
+        m_header->recordSize = sizeof(Record);
+        m_header->capacity = capacity;
+        m_header->reserved = 0;
+    }
+
+    for (int i = 0; i < capacity; ++i) {
+        Record& r = m_records[i];
+        r.appId[APP_ID_MAX - 1] = '\0';
+        if (r.appId[0] != '\0')
+            m_index[r.appId] = i;
+    }
+
+    Logger::normal(to_string(m_index.size()) + " profiles in " + path, getClassName());
+    return true;
+}
+
+void LaunchProfile::close()
+{
+    if (m_header) {
+        msync(m_header, m_size, MS_SYNC);
+        munmap(m_header, m_size);
+    }
+
+    m_header = nullptr;
+    m_records = nullptr;
+    m_size = 0;
+    m_index.clear();
+}
+
+bool LaunchProfile::getPeak(const string& appId, unsigned long& peakKb)
+{
+    auto it = m_index.find(appId);
+    if (it == m_index.end())
+        return false;
+
+    peakKb = m_records[it->second].peakKb;
+    return true;
+}
+
+/*
+ * Learn <peakKb> of a launch. A higher peak is taken at once, a lower one
+ * moves the profile by a quarter, so that one light launch doesn't make
+ * the next request too small.
+ */
+void LaunchProfile::update(const string& appId, unsigned long peakKb)
+{
+    if (!m_header || appId.empty() || appId.size() >= APP_ID_MAX)
+        return;
+
+    int index;
+    auto it = m_index.find(appId);
+
+    if (it != m_index.end()) {
+        index = it->second;
+    } else {
+        /* Empty record first, otherwise least recently updated one */
+        index = 0;
+        for (uint32_t i = 0; i < m_header->capacity; ++i) {
+            if (m_records[i].appId[0] == '\0') {
+                index = i;
+                break;
+            }
+            if (m_records[i].updated < m_records[index].updated)
+                index = i;
+        }
+
+        if (m_records[index].appId[0] != '\0')
+            m_index.erase(m_records[index].appId);
+
+        memset(&m_records[index], 0, sizeof(Record));
+        strncpy(m_records[index].appId, appId.c_str(), APP_ID_MAX - 1);
+        m_index[appId] = index;
+    }
+
+    Record& r = m_records[index];
+    if (r.launches == 0 || peakKb >= r.peakKb)
+        r.peakKb = peakKb;
+    else
+        r.peakKb = (uint32_t)(((uint64_t)r.peakKb * 3 + peakKb) / 4);
+    r.launches++;
+    r.updated = time(NULL);
+
+    msync(m_header, m_size, MS_ASYNC);
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef BASE_LAUNCHPROFILE_H_
+#define BASE_LAUNCHPROFILE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "interface/IClassName.h"
+
+using namespace std;
+
+/*
+ * Peak PSS of each app shortly after launch, learned from its samples and
+ * used as default size of requireMemory. Records are fixed-size and the
+ * file is mmap'd, so that an update is a store and survives restarts.
+ * When the file is full, the least recently updated record is reused.
+ */
+class LaunchProfile : public IClassName {
+public:
+    explicit LaunchProfile();
+    virtual ~LaunchProfile();
+
+    bool open(const string& path, int capacity);
+    void close();
+
+    bool getPeak(const string& appId, unsigned long& peakKb);
+    void update(const string& appId, unsigned long peakKb);
+
+private:
+    static const uint32_t MAGIC = 0x4c4d4d50;   // "PMML"
+    static const uint16_t VERSION = 1;
+    static const int APP_ID_MAX = 96;
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t capacity;
+        uint32_t reserved;
+    };
+
+    struct Record {
+        char appId[APP_ID_MAX];     // NUL terminated, empty if not used
+        uint32_t peakKb;            // learned peak PSS
+        uint32_t launches;          // launches learned
+        int64_t updated;            // realtime seconds of last update
+    };
+
+    Header* m_header;
+    Record* m_records;
+    size_t m_size;
+    unordered_map<string, int> m_index;     // appId to record
+};
+
+#endif /* BASE_LAUNCHPROFILE_H_ */
@@ -0,0 +1,177 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "base/MemoryLevel.h"
+#include "MemoryManager.h"
+
+#include "util/Time.h"
+
+MemoryLevel::MemoryLevel()
+    : m_index(0),
+      m_exit(0),
+      m_dwell(0),
+      m_action(LevelAction::NONE)
+{
+    setClassName("MemoryLevel");
+}
+
+void MemoryLevel::init(int index)
+{
+    const MemoryLevelSetting& setting = SettingManager::getMemoryLevel(index);
+
+    m_name = setting.name;
+    m_index = index;
+    m_exit = setting.exit;
+    m_dwell = setting.dwell;
+
+    if (setting.action == "reclaim")
+        m_action = LevelAction::RECLAIM;
+    else if (setting.action == "low")
+        m_action = LevelAction::LOW;
+    else if (setting.action == "critical")
+        m_action = LevelAction::CRITICAL;
+    else
+        m_action = LevelAction::NONE;
+}
+
+void MemoryLevel::action(string& errorText) const
+{
+    runAction(m_action, m_exit, errorText);
+}
+
+void MemoryLevel::runAction(LevelAction action, int exitLevel, string& errorText)
+{
+    MemoryManager* mm = MemoryManager::getInstance();
+
+    if (action == LevelAction::NONE || !mm->isReady())
+        return;
+    const auto& sessions = mm->getSessionMonitor().getSessions();
+    int allAppCount = 0;
+
+    unsigned long targetKb = mm->getReclaimTarget(exitLevel);
+
+    if (action == LevelAction::CRITICAL) {
+        for (auto it = sessions.cbegin(); it != sessions.cend(); ++it) {
+            it->second->m_runtime->reclaimMemory(true, targetKb);
+            allAppCount += it->second->m_runtime->countApp();
+        }
+
+        if (allAppCount == 0)
+            errorText = "Failed to reclaim required memory. All apps were closed";
+        return;
+    }
+
+    /*
+     * Freeze idle apps, reclaim background cgroups, page out apps sharing
+     * a cgroup, then close apps for the rest
+     */
+    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it)
+        it->second->m_runtime->freezeIdleApps();
+
+    bool reclaimed = false;
+    for (auto it = sessions.cbegin(); it != sessions.cend() && targetKb > 0; ++it)
+        reclaimed = (it->second->m_runtime->reclaimBackground(targetKb) > 0) || reclaimed;
+    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it)
+        reclaimed = (it->second->m_runtime->pageoutBackground(targetKb) > 0) || reclaimed;
+
+    if (action == LevelAction::RECLAIM)
+        return;
+
+    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it) {
+        if (reclaimed && targetKb == 0) {
+            allAppCount += it->second->m_runtime->countApp();
+            continue;
+        }
+        it->second->m_runtime->reclaimMemory(false, targetKb);
+        allAppCount += it->second->m_runtime->countApp();
+    }
+
+    if (allAppCount == 0)
+        errorText = "Failed to reclaim required memory. All apps were closed";
+}
+
+/*
+ * A tier is kept while available memory is below its exit and above the
+ * enter of the next tier. Otherwise the most severe tier whose enter is
+ * crossed is taken.
+ */
+int MemoryLevel::decide(int index, long memAvail)
+{
+    int count = SettingManager::getMemoryLevelCount();
+    bool keep = true;
+
+    if (index > 0 && memAvail >= SettingManager::getMemoryLevel(index).exit)
+        keep = false;
+    if (index + 1 < count && memAvail <= SettingManager::getMemoryLevel(index + 1).enter)
+        keep = false;
+    if (keep)
+        return index;
+
+    for (int i = count - 1; i > 0; --i) {
+        if (memAvail < SettingManager::getMemoryLevel(i).enter)
+            return i;
+    }
+    return 0;
+}
+
+MemoryLevelTable::MemoryLevelTable()
+    : m_count(1),
+      m_current(0),
+      m_enterTime(0),
+      m_actionTime(0)
+{
+    setClassName("MemoryLevelTable");
+}
+
+void MemoryLevelTable::init()
+{
+    m_count = SettingManager::getMemoryLevelCount();
+    for (int i = 0; i < m_count; ++i)
+        m_levels[i].init(i);
+
+    m_current = 0;
+    m_enterTime = Time::getSystemTimeMs();
+    m_actionTime = 0;
+}
+
+const MemoryLevel* MemoryLevelTable::update(long memAvail)
+{
+    int next = MemoryLevel::decide(m_current, memAvail);
+
+    if (next == m_current)
+        return nullptr;
+
+    long long now = Time::getSystemTimeMs();
+    if (next < m_current && now - m_enterTime < m_levels[m_current].getDwell())
+        return nullptr;
+
+    const MemoryLevel* prev = &m_levels[m_current];
+    m_current = next;
+    m_enterTime = now;
+    m_actionTime = 0;
+    return prev;
+}
+
+bool MemoryLevelTable::claimAction()
+{
+    long long now = Time::getSystemTimeMs();
+
+    if (m_actionTime != 0 && now - m_actionTime < SettingManager::getSamplingActionPeriod())
+        return false;
+
+    m_actionTime = now;
+    return true;
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef BASE_MEMORYLEVEL_H_
+#define BASE_MEMORYLEVEL_H_
+
+#include <string>
+
+#include "setting/SettingManager.h"
+#include "interface/IClassName.h"
+
+using namespace std;
+
+/* What a tier does on each sample, in order of strength */
+enum class LevelAction : char {
+    NONE = 0,
+    RECLAIM,    // freeze, memory.reclaim and page out background apps
+    LOW,        // RECLAIM, then close background apps
+    CRITICAL,   // close apps including foreground ones
+};
+
+/* One tier of memory level, built once from SettingManager */
+class MemoryLevel : public IClassName {
+public:
+    explicit MemoryLevel();
+    virtual ~MemoryLevel() {}
+
+    void init(int index);
+
+    const string& toString() const { return m_name; }
+    int getIndex() const { return m_index; }
+    LevelAction getAction() const { return m_action; }
+    int getDwell() const { return m_dwell; }
+
+    void action(string& errorText) const;
+
+    /* Run <action> to get back above <exitLevel> MB */
+    static void runAction(LevelAction action, int exitLevel, string& errorText);
+
+    /* Tier for <memAvail> MB from tier <index> with hysteresis, thread-safe */
+    static int decide(int index, long memAvail);
+
+private:
+    string m_name;
+    int m_index;
+    int m_exit;
+    int m_dwell;
+    LevelAction m_action;
+};
+
+/*
+ * Table-driven memory level. All tiers are allocated with the table and
+ * a transition only moves the current index, so that nothing is allocated
+ * when memory is scarcest. A lower tier is taken only after the current
+ * one is kept for its dwell time. Sampling gets faster near thresholds, so
+ * action of a kept tier is repeated once per action period at most.
+ */
+class MemoryLevelTable : public IClassName {
+public:
+    explicit MemoryLevelTable();
+    virtual ~MemoryLevelTable() {}
+
+    void init();
+
+    const MemoryLevel& getCurrent() const { return m_levels[m_current]; }
+    const MemoryLevel& getLevel(int index) const { return m_levels[index]; }
+    int getCount() const { return m_count; }
+
+    /* Returns previous tier if changed, nullptr otherwise */
+    const MemoryLevel* update(long memAvail);
+
+    /* True if action of current tier may run now, which restarts its period */
+    bool claimAction();
+
+private:
+    MemoryLevel m_levels[SettingManager::MAX_MEMORY_LEVELS];
+    int m_count;
+    int m_current;
+    long long m_enterTime;  // ms monotonic when current tier is entered
+    long long m_actionTime; // ms monotonic when action is run, 0 if not yet
+};
+
+#endif /* BASE_MEMORYLEVEL_H_ */
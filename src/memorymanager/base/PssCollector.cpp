@@ -0,0 +1,208 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <chrono>
+
+#include "base/PssCollector.h"
+
+#include "setting/SettingManager.h"
+
+#include "util/Proc.h"
+#include "util/Time.h"
+#include "util/Logger.h"
+
+void PssCollector::read(const int pid)
+{
+    SmapsRollupSnapshot smaps;
+    bool exist = Proc::getSmapsRollup(pid, smaps);
+    long long now = Time::getSystemTimeMs();
+
+    lock_guard<mutex> lock(m_mutex);
+
+    /* pid may be dropped by collect() while reading */
+    auto it = m_entries.find(pid);
+    if (it == m_entries.end())
+        return;
+
+    Entry& e = it->second;
+    e.result.pssKb = exist ? smaps.pss : 0;
+    e.result.ussKb = exist ? smaps.privateClean + smaps.privateDirty : 0;
+    e.result.swapKb = exist ? smaps.swapPss : 0;
+    e.result.time = now;
+    e.result.exist = exist;
+    e.pssRssKb = e.result.rssKb;
+    e.queued = false;
+}
+
+bool PssCollector::needRefine(const Entry& e) const
+{
+    if (e.result.time == 0)
+        return true;
+
+    unsigned long delta = (e.result.rssKb > e.pssRssKb) ?
+                          e.result.rssKb - e.pssRssKb :
+                          e.pssRssKb - e.result.rssKb;
+    return delta >= (unsigned long)SettingManager::getPssRssDelta();
+}
+
+void PssCollector::run()
+{
+    unique_lock<mutex> lock(m_mutex);
+
+    while (true) {
+        m_workCond.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_stop)
+            break;
+
+        int pid = m_queue.front();
+        m_queue.pop_front();
+        ++m_busy;
+
+        lock.unlock();
+        read(pid);
+        lock.lock();
+
+        if (--m_busy == 0 && m_queue.empty())
+            m_doneCond.notify_all();
+    }
+}
+
+int PssCollector::collect(const vector<int>& pids, int deadline)
+{
+    long long start = Time::getSystemTimeMs();
+    vector<pair<unsigned long, int>> rss;
+    vector<int> refines;
+    int fresh = 0;
+
+    /* Tier 1 : RSS of all processes, without lock as it touches nothing shared */
+    rss.reserve(pids.size());
+    for (int pid : pids) {
+        unsigned long rssKb = 0;
+        if (Proc::getStatmRss(pid, rssKb))
+            rss.push_back(make_pair(rssKb, pid));
+        else
+            rss.push_back(make_pair(0UL, -pid));
+    }
+
+    /* Biggest processes first, they are the most likely victims */
+    size_t topN = min(rss.size(), (size_t)max(SettingManager::getPssTopN(), 0));
+    partial_sort(rss.begin(), rss.begin() + topN, rss.end(),
+                 [](const pair<unsigned long, int>& a, const pair<unsigned long, int>& b) {
+                     return a.first > b.first;
+                 });
+
+    unique_lock<mutex> lock(m_mutex);
+
+    ++m_generation;
+    for (size_t i = 0; i < rss.size(); ++i) {
+        bool gone = rss[i].second < 0;
+        int pid = gone ? -rss[i].second : rss[i].second;
+        Entry& e = m_entries[pid];
+
+        e.generation = m_generation;
+        if (gone) {
+            e.result.exist = false;
+            e.result.time = start;
+            continue;
+        }
+
+        e.result.rssKb = rss[i].first;
+        e.result.exist = true;
+
+        /* Tier 2 : PSS of top-N and of processes whose RSS moved */
+        if (i >= topN && !needRefine(e))
+            continue;
+
+        refines.push_back(pid);
+        if (!e.queued) {
+            e.queued = true;
+            m_queue.push_back(pid);
+        }
+    }
+
+    /* Forget processes which are not asked anymore */
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->second.generation != m_generation)
+            it = m_entries.erase(it);
+        else
+            ++it;
+    }
+
+    if (m_workers.empty()) {
+        /* No worker. Read all of them here */
+        while (!m_queue.empty()) {
+            int pid = m_queue.front();
+            m_queue.pop_front();
+
+            lock.unlock();
+            read(pid);
+            lock.lock();
+        }
+    } else if (!m_queue.empty()) {
+        m_workCond.notify_all();
+        m_doneCond.wait_for(lock, chrono::milliseconds(deadline),
+                            [this] { return m_busy == 0 && m_queue.empty(); });
+    }
+
+    for (int pid : refines) {
+        auto it = m_entries.find(pid);
+        if (it != m_entries.end() && it->second.result.time >= start)
+            ++fresh;
+    }
+
+    if (fresh < (int)refines.size() && deadline > 0)
+        Logger::verbose("Deadline is passed, " + to_string(refines.size() - fresh) +
+                        " of " + to_string(refines.size()) + " PSS are stale",
+                        getClassName());
+
+    return fresh;
+}
+
+bool PssCollector::getResult(const int pid, PssResult& result)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    auto it = m_entries.find(pid);
+    if (it == m_entries.end())
+        return false;
+
+    result = it->second.result;
+    return true;
+}
+
+PssCollector::PssCollector(int workers)
+    : m_generation(0),
+      m_busy(0),
+      m_stop(false)
+{
+    setClassName("PssCollector");
+
+    for (int i = 0; i < workers; ++i)
+        m_workers.push_back(thread(&PssCollector::run, this));
+}
+
+PssCollector::~PssCollector()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workCond.notify_all();
+
+    for (auto& t : m_workers)
+        t.join();
+}
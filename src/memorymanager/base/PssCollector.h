@@ -0,0 +1,88 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef BASE_PSSCOLLECTOR_H_
+#define BASE_PSSCOLLECTOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "interface/IClassName.h"
+
+using namespace std;
+
+/*
+ * Latest memory usage of a process. RSS is read on every collect(), while
+ * PSS and USS are refined less often and time tells how old they are.
+ */
+struct PssResult {
+    unsigned long rssKb;    // RSS in KB size from statm
+    unsigned long pssKb;    // PSS in KB size from smaps_rollup
+    unsigned long ussKb;    // Private_Clean + Private_Dirty in KB size
+    unsigned long swapKb;   // SwapPss, share of swapped out in KB size
+    long long time;         // when PSS is read, ms monotonic. 0 if never read
+    bool exist;             // false if process is gone
+};
+
+/*
+ * Estimates memory usage of many processes in two tiers.
+ * RSS from statm is cheap and read for all pids on every collect().
+ * smaps_rollup walks all VMAs of the process in kernel, so it is read only
+ * for the biggest processes and for processes whose RSS moved since their
+ * last PSS. Those reads run on a small worker pool and collect() waits only
+ * until deadline, pids which are not read yet keep their previous result.
+ */
+class PssCollector : public IClassName {
+public:
+    explicit PssCollector(int workers);
+    virtual ~PssCollector();
+
+    /*
+     * Returns number of pids whose PSS is refreshed in this call. <pids>
+     * should be all processes to follow, others are forgotten.
+     */
+    int collect(const vector<int>& pids, int deadline);
+    bool getResult(const int pid, PssResult& result);
+
+private:
+    struct Entry {
+        PssResult result;
+        unsigned long pssRssKb;     // RSS when PSS is read
+        unsigned int generation;    // last collect() which asked this pid
+        bool queued;
+    };
+
+    void run();
+    void read(const int pid);
+    bool needRefine(const Entry& e) const;
+
+    mutex m_mutex;
+    condition_variable m_workCond;  // signaled when pid is queued
+    condition_variable m_doneCond;  // signaled when queue is drained
+    deque<int> m_queue;
+    unordered_map<int, Entry> m_entries;
+    unsigned int m_generation;
+    int m_busy;
+    bool m_stop;
+
+    vector<thread> m_workers;
+};
+
+#endif /* BASE_PSSCOLLECTOR_H_ */
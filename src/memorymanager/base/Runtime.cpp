@@ -17,14 +17,17 @@
 #include <boost/tokenizer.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
 #include "MemoryManager.h"
 #include "base/Runtime.h"
 #include "sam/SAM.h"
+#include "setting/SettingManager.h"
 
 #include "util/Proc.h"
+#include "util/Time.h"
 #include "util/Logger.h"
 #include "util/Cgroup.h"
 #include "util/LinuxProcess.h"
@@ -32,28 +35,32 @@
 const string Runtime::WAM_SERVICE_ID = "webapp-mgr.service";
 const string Runtime::SAM_SERVICE_ID = "sam.service";
 
-long BaseProcess::getPssValue(const int pid)
+void Application::updateMemStat(PssCollector& collector)
 {
-    map<string, string> smaps;
+    PssResult result;
 
-    if (!Proc::getSmapsRollup(pid, smaps))
-        return -1;
+    if (!collector.getResult(m_pid, result))
+        return;
 
-    auto it_pss = smaps.find("Pss");
-    if (it_pss == smaps.end())
-        return 0;
-    else
-        return stoul(it_pss->second);
-}
+    if (!result.exist) {
+        m_rssKb = m_pssKb = m_ussKb = m_swapKb = 0;
+        return;
+    }
 
-void Application::updateMemStat()
-{
-    long ret = getPssValue(m_pid);
+    m_rssKb = result.rssKb;
+    Proc::getOomScoreAdj(m_pid, m_oomScoreAdj);
 
-    if (ret > 0 || ret == 0)
-        m_pssKb = static_cast<unsigned long>(ret);
-    else
-        m_pssKb = 0;
+    /* PSS is not read yet, keep previous value */
+    if (result.time == 0)
+        return;
+
+    m_pssKb = result.pssKb;
+    m_ussKb = result.ussKb;
+    m_swapKb = result.swapKb;
+    m_pssTime = result.time;
+
+    if (m_launchTime && m_pssTime - m_launchTime <= SettingManager::getProfileWindow())
+        m_launchPeakKb = max(m_launchPeakKb, m_pssKb);
 }
 
 void Application::print()
@@ -74,17 +81,50 @@ void Application::print(JValue& json)
     json.put("status", m_status);
     json.put("type", m_type);
     json.put("pid", m_pid);
+    json.put("rss", to_string(m_rssKb));
     json.put("pss", to_string(m_pssKb));
+    json.put("uss", to_string(m_ussKb));
+    json.put("pssAge", m_pssTime ? (int64_t)(Time::getSystemTimeMs() - m_pssTime) : -1);
+    json.put("frozen", isFrozen());
 }
 
 void Application::setPid(const int pid)
 {
+    /* Launched now, footprint is learned for profile.window ms */
+    if (m_pid <= 0 && pid > 0) {
+        m_launchTime = Time::getSystemTimeMs();
+        m_launchPeakKb = 0;
+    }
+
     m_pid = pid;
 }
 
+/* Returns peak PSS after launch once, when profile.window is over */
+bool Application::takeLaunchPeak(unsigned long& peakKb)
+{
+    if (m_launchTime == 0)
+        return false;
+
+    if (Time::getSystemTimeMs() - m_launchTime < SettingManager::getProfileWindow())
+        return false;
+
+    m_launchTime = 0;
+    peakKb = m_launchPeakKb;
+    return peakKb > 0;
+}
+
 void Application::setStatus(const string& status)
 {
     m_status = status;
+    m_statusTime = Time::getSystemTimeMs();
+    m_advice = 0;
+
+    if (status == "foreground")
+        m_appStatus = AppStatus::FOREGROUND;
+    else if (status == "background")
+        m_appStatus = AppStatus::BACKGROUND;
+    else
+        m_appStatus = AppStatus::OTHER;
 }
 
 void Application::setType(const string& type)
@@ -110,7 +150,15 @@ Application::Application(const string& instanceId, const string& appId,
      m_pid(pid)
 {
     setClassName("Application");
+    setStatus(status);
+    m_rssKb = 0;
     m_pssKb = 0;
+    m_ussKb = 0;
+    m_swapKb = 0;
+    m_oomScoreAdj = 0;
+    m_pssTime = 0;
+    m_launchTime = 0;
+    m_launchPeakKb = 0;
 }
 
 template<typename T, typename U>
@@ -131,20 +179,37 @@ void Service::toString(map<T, U>& pMap, string& str1, string& str2)
     str2 = std::move(ret2);
 }
 
-void Service::updateMemStat()
+void Service::updateMemStat(PssCollector& collector)
 {
+    PssResult result;
+    long long oldest = 0;
+
     auto it = m_pidPss.begin();
     while (it != m_pidPss.end()) {
-        long localPss = getPssValue(it->first);
+        if (!collector.getResult(it->first, result)) {
+            ++it;
+            continue;
+        }
 
-        if (localPss < 0) {
+        if (!result.exist) {
             it = m_pidPss.erase(it);
             continue;
-        } else {
-            it->second = (unsigned long)localPss;
+        }
+
+        /* PSS is not read yet, keep previous value */
+        if (result.time == 0) {
             ++it;
+            continue;
         }
+
+        it->second = result.pssKb;
+        if (oldest == 0 || result.time < oldest)
+            oldest = result.time;
+        ++it;
     }
+
+    if (oldest)
+        m_pssTime = oldest;
 }
 
 void Service::print()
@@ -171,10 +236,12 @@ void Service::print(JValue& json)
     json.put("serviceId", m_serviceId);
     json.put("pid", pid.c_str());
     json.put("pss", pss.c_str());
+    json.put("pssAge", m_pssTime ? (int64_t)(Time::getSystemTimeMs() - m_pssTime) : -1);
 }
 
 Service::Service(const string& serviceId, const list<int>& pids)
-    : m_serviceId(serviceId)
+    : m_serviceId(serviceId),
+      m_pssTime(0)
 {
     setClassName("Service");
 
@@ -182,12 +249,26 @@ Service::Service(const string& serviceId, const list<int>& pids)
         m_pidPss.insert(make_pair(pid, 0));
 }
 
+/* Processes of this runtime to be collected with other sessions */
+void Runtime::getPids(vector<int>& pids) const
+{
+    for (auto svc : m_services) {
+        for (const auto& pp : svc->getPidPss())
+            pids.push_back(pp.first);
+    }
+    for (const auto& app : m_applications)
+        pids.push_back(app.getPid());
+}
+
+/* Take results of the latest PssCollector::collect() */
 void Runtime::updateMemStat()
 {
+    PssCollector& collector = MemoryManager::getInstance()->getPssCollector();
+
     /* Update Service Memory Stat */
     auto it = m_services.begin();
     while (it != m_services.end()) {
-        (*it)->updateMemStat();
+        (*it)->updateMemStat(collector);
 
         /* If pid is fully empty, remove Service object */
         if ((*it)->getPidPss().empty()) {
@@ -199,28 +280,347 @@ void Runtime::updateMemStat()
     }
 
     /* Update Application Memory Stat */
-    for (auto it = m_applications.begin(); it != m_applications.end(); ++it)
-        it->updateMemStat();
+    LaunchProfile& profile = MemoryManager::getInstance()->getLaunchProfile();
+    for (auto it = m_applications.begin(); it != m_applications.end(); ++it) {
+        unsigned long peakKb;
+
+        it->updateMemStat(collector);
+        if (it->takeLaunchPeak(peakKb)) {
+            Logger::normal("Launch peak of " + it->getAppId() + " " + to_string(peakKb) + " kb",
+                           getClassName());
+            profile.update(it->getAppId(), peakKb);
+        }
+    }
 }
 
 bool Runtime::reclaimMemory(bool critical)
 {
-    if (m_applications.empty())
-        return false;
+    unsigned long targetKb = 0;
+
+    return reclaimMemory(critical, targetKb);
+}
+
+void Runtime::getVictimCandidates(bool critical, vector<VictimCandidate>& candidates)
+{
+    int rank = 0;
+
+    /* m_applications is kept in LRU order, front is least recently used */
+    for (auto it = m_applications.begin(); it != m_applications.end(); ++it) {
+        VictimCandidate c;
 
-    auto it = m_applications.front();
+        if (SettingManager::isProtectedApp(it->getAppId()))
+            continue;
+
+        /* Already counted as freed by whoever asked to close it */
+        if (m_session.m_sam->isClosing(it->getAppId(), it->getInstanceId()))
+            continue;
 
-    if (it.getStatus() == "foreground" && !critical)
+        c.foreground = it->isForeground();
+        if (c.foreground && !critical)
+            continue;
+
+        c.runtime = this;
+        c.app = &(*it);
+        c.lruRank = rank++;
+        c.pssKb = it->getPssKb();
+        c.ussKb = it->getUssKb();
+        c.swapKb = it->getSwapKb();
+        c.oomScoreAdj = it->getOomScoreAdj();
+        c.web = (it->getType() == "web");
+        c.score = 0;
+        candidates.push_back(c);
+    }
+}
+
+/* Returns true only if a new close request is sent to SAM */
+bool Runtime::closeApp(const string& appId, const string& instanceId)
+{
+    /* Frozen app can't handle the close request */
+    auto index = m_appIndex.find(makeAppKey(appId, instanceId));
+    if (index != m_appIndex.end() && index->second->isFrozen())
+        thawCgroup(index->second->getFrozenPath());
+
+    /* Killing event is posted once SAM has really closed the app */
+    CloseResult result = m_session.m_sam->close(appId, instanceId,
+        [appId, instanceId](bool success, long long) {
+            if (!success)
+                return;
+
+            MemoryManager* mm = MemoryManager::getInstance();
+            mm->handleRuntimeChange(appId, instanceId, RuntimeChange::APP_CLOSE);
+        });
+
+    return result == CloseResult::SENT;
+}
+
+/*
+ * Close apps in order of VictimScorer until <targetKb> is expected to be
+ * freed, at most victim.maxCount apps. Only one app is closed if <targetKb>
+ * is 0. <targetKb> is decreased by what closed apps are expected to free.
+ */
+bool Runtime::reclaimMemory(bool critical, unsigned long& targetKb)
+{
+    MemoryManager* mm = MemoryManager::getInstance();
+    vector<VictimCandidate> candidates;
+    vector<pair<pair<string, string>, unsigned long>> victims;
+    unsigned long expectedKb = 0;
+    unsigned long freedKb = 0;
+    bool ret = false;
+
+    getVictimCandidates(critical, candidates);
+    if (candidates.empty())
         return false;
 
-    if (m_session.m_sam->close(it.getAppId(), it.getInstanceId())) {
-        MemoryManager* mm = MemoryManager::getInstance();
-        mm->handleRuntimeChange(it.getAppId(), it.getInstanceId(),
-                                RuntimeChange::APP_CLOSE);
-        return true;
+    mm->getVictimScorer().score(candidates);
+
+    /* Foreground apps are closed only after all background apps */
+    stable_sort(candidates.begin(), candidates.end(),
+                [](const VictimCandidate& a, const VictimCandidate& b) {
+                    if (a.foreground != b.foreground)
+                        return !a.foreground;
+                    return a.score > b.score;
+                });
+
+    size_t maxCount = (targetKb > 0) ? max(SettingManager::getVictimMaxCount(), 1) : 1;
+    for (const VictimCandidate& c : candidates) {
+        if (victims.size() >= maxCount || (!victims.empty() && expectedKb >= targetKb))
+            break;
+
+        Logger::normal("Victim " + c.app->getAppId() + " score " + to_string(c.score) +
+                       " uss " + to_string(c.ussKb) + " kb", getClassName());
+        unsigned long kb = c.ussKb ? c.ussKb : c.pssKb;
+        victims.push_back(make_pair(make_pair(c.app->getAppId(), c.app->getInstanceId()), kb));
+        expectedKb += kb;
+    }
+
+    /* Copied above, as closing may change m_applications */
+    for (const auto& v : victims) {
+        if (closeApp(v.first.first, v.first.second)) {
+            freedKb += v.second;
+            ret = true;
+        }
+    }
+
+    targetKb = (freedKb < targetKb) ? targetKb - freedKb : 0;
+    return ret;
+}
+
+/*
+ * Push pages of background apps out through memory.reclaim, in LRU order,
+ * before any app is closed. Only cgroups of background apps alone are
+ * reclaimed, apps in shared ones are left to pageoutBackground(). A write
+ * asks reclaim.chunk KB at most, as it blocks main loop until done.
+ * <targetKb> is decreased by what memory.current really dropped.
+ */
+unsigned long Runtime::reclaimBackground(unsigned long& targetKb)
+{
+    unordered_set<string> background;
+    unordered_set<string> paths;
+    unsigned long reclaimedKb = 0;
+    string path;
+
+    if (!SettingManager::getReclaimEnable() || targetKb == 0)
+        return 0;
+
+    getBackgroundCgroups(background);
+
+    for (auto it = m_applications.begin(); it != m_foregroundBegin; ++it) {
+        if (it->getPid() <= 0 || it->getAppStatus() != AppStatus::BACKGROUND ||
+            !Cgroup::getPathOfPid(it->getPid(), path))
+            continue;
+        if (!background.count(path) || !paths.insert(path).second)
+            continue;
+
+        unsigned long chunkKb = min(targetKb - reclaimedKb,
+                                    (unsigned long)SettingManager::getReclaimChunk());
+        unsigned long kb = reclaimCgroup(path, chunkKb);
+        reclaimedKb += kb;
+        if (reclaimedKb >= targetKb)
+            break;
+    }
+
+    targetKb = (reclaimedKb < targetKb) ? targetKb - reclaimedKb : 0;
+    return reclaimedKb;
+}
+
+unsigned long Runtime::reclaimCgroup(const string& path, unsigned long targetKb)
+{
+    unsigned long long reclaimed = 0;
+    long long begin = Time::getSystemTimeMs();
+
+    if (!Cgroup::reclaim(path, (unsigned long long)targetKb * 1024,
+                         SettingManager::getReclaimSwappiness(), reclaimed)) {
+        Logger::warning("Failed to reclaim " + path, getClassName());
+        return 0;
+    }
+
+    unsigned long reclaimedKb = (unsigned long)(reclaimed / 1024);
+    Logger::normal("Reclaimed " + to_string(reclaimedKb) + " / " + to_string(targetKb) +
+                   " kb from " + path + " in " +
+                   to_string(Time::getSystemTimeMs() - begin) + " ms", getClassName());
+    return reclaimedKb;
+}
+
+/*
+ * Cgroups whose processes all belong to background apps, so that they can
+ * be reclaimed or frozen as a whole. Cgroups shared with services, like
+ * WAM with its renderers, or with apps in other status are left out.
+ */
+void Runtime::getBackgroundCgroups(unordered_set<string>& paths)
+{
+    unordered_set<int> pids;
+    unordered_set<string> checked;
+    vector<int> procs;
+    string path;
+
+    for (auto it = m_applications.begin(); it != m_foregroundBegin; ++it) {
+        if (it->getPid() > 0 && it->getAppStatus() == AppStatus::BACKGROUND &&
+            !SettingManager::isProtectedApp(it->getAppId()))
+            pids.insert(it->getPid());
+    }
+
+    for (int pid : pids) {
+        if (!Cgroup::getPathOfPid(pid, path) || !checked.insert(path).second)
+            continue;
+        if (!Cgroup::getProcs(path, procs) || procs.empty())
+            continue;
+
+        bool alone = all_of(procs.begin(), procs.end(),
+                            [&pids](int p) { return pids.count(p) > 0; });
+        if (alone)
+            paths.insert(path);
     }
+}
+
+/*
+ * Freeze cgroups of apps which have been in background for freeze.idle ms,
+ * so that they neither allocate nor touch their working set while memory
+ * is low. Only cgroups of background apps alone are frozen, a shared one
+ * like WAM would stall launches and closes of other apps. They are thawed
+ * by any lifecycle event other than background.
+ */
+int Runtime::freezeIdleApps()
+{
+    unordered_set<string> background;
+    unordered_set<string> skipped;
+    long long now = Time::getSystemTimeMs();
+    int count = 0;
+    string path;
+
+    if (!SettingManager::getFreezeEnable())
+        return 0;
+
+    getBackgroundCgroups(background);
+
+    for (auto it = m_applications.begin(); it != m_foregroundBegin; ++it) {
+        if (it->isFrozen() || it->getPid() <= 0 ||
+            it->getAppStatus() != AppStatus::BACKGROUND ||
+            now - it->getStatusTime() < SettingManager::getFreezeIdle() ||
+            SettingManager::isProtectedApp(it->getAppId()))
+            continue;
+
+        if (!Cgroup::getPathOfPid(it->getPid(), path) || !background.count(path) ||
+            skipped.count(path))
+            continue;
+
+        if (!Cgroup::freeze(path, true)) {
+            Logger::warning("Failed to freeze " + path, getClassName());
+            skipped.insert(path);
+            continue;
+        }
+
+        /* Apps in the same cgroup are frozen together */
+        for (auto app = m_applications.begin(); app != m_foregroundBegin; ++app) {
+            if (!app->isFrozen() && app->getPid() > 0 && app != it) {
+                string appPath;
+                if (Cgroup::getPathOfPid(app->getPid(), appPath) && appPath == path)
+                    app->setFrozenPath(path);
+            }
+        }
+        it->setFrozenPath(path);
+        skipped.insert(path);
+        count++;
+
+        Logger::normal("Frozen " + it->getAppId() + " in " + path, getClassName());
+    }
+    return count;
+}
+
+/*
+ * process_madvise anonymous memory of background apps which can't be
+ * reclaimed through their own cgroup, like web apps in WAM renderers.
+ * Apps idle for pageout.cold ms get MADV_COLD and ones idle for
+ * pageout.idle ms get MADV_PAGEOUT while <targetKb> remains, once in a
+ * background period. <targetKb> is decreased by the RSS drop.
+ */
+unsigned long Runtime::pageoutBackground(unsigned long& targetKb)
+{
+    unordered_set<string> background;
+    long long now = Time::getSystemTimeMs();
+    unsigned long pagedKb = 0;
+    string path;
+
+    if (!SettingManager::getPageoutEnable())
+        return 0;
 
-    return false;
+    getBackgroundCgroups(background);
+
+    for (auto it = m_applications.begin(); it != m_foregroundBegin; ++it) {
+        long long idle = now - it->getStatusTime();
+        int advice = 0;
+
+        if (it->getPid() <= 0 || it->getAppStatus() != AppStatus::BACKGROUND ||
+            SettingManager::isProtectedApp(it->getAppId()))
+            continue;
+
+        /* Left to reclaimBackground() */
+        if (Cgroup::getPathOfPid(it->getPid(), path) && background.count(path))
+            continue;
+
+        if (idle >= SettingManager::getPageoutIdle() && targetKb > pagedKb)
+            advice = MADV_PAGEOUT;
+        else if (idle >= SettingManager::getPageoutCold())
+            advice = MADV_COLD;
+
+        if (advice == 0 || it->getAdvice() == advice || it->getAdvice() == MADV_PAGEOUT)
+            continue;
+
+        unsigned long beforeKb = 0, afterKb = 0, advisedKb = 0;
+        Proc::getStatmRss(it->getPid(), beforeKb);
+        if (!Proc::adviseAnon(it->getPid(), advice, advisedKb)) {
+            Logger::warning("Failed to advise " + it->getAppId(), getClassName());
+            continue;
+        }
+        it->setAdvice(advice);
+
+        if (advice == MADV_COLD) {
+            Logger::normal("Cold " + it->getAppId() + " " + to_string(advisedKb) + " kb",
+                           getClassName());
+            continue;
+        }
+
+        Proc::getStatmRss(it->getPid(), afterKb);
+        unsigned long kb = (afterKb < beforeKb) ? beforeKb - afterKb : 0;
+        pagedKb += kb;
+        Logger::normal("Paged out " + it->getAppId() + " " + to_string(kb) + " / " +
+                       to_string(advisedKb) + " kb", getClassName());
+    }
+
+    targetKb = (pagedKb < targetKb) ? targetKb - pagedKb : 0;
+    return pagedKb;
+}
+
+void Runtime::thawCgroup(const string& path)
+{
+    if (!Cgroup::freeze(path, false))
+        Logger::warning("Failed to thaw " + path, getClassName());
+    else
+        Logger::normal("Thawed " + path, getClassName());
+
+    for (auto it = m_applications.begin(); it != m_applications.end(); ++it) {
+        if (it->getFrozenPath() == path)
+            it->setFrozenPath("");
+    }
 }
 
 void Runtime::clearReservedPid(void)
@@ -253,23 +653,40 @@ void Runtime::updateService(const string& serviceId, const int pid)
     ((*it)->getPidPss()).erase(pid);
 }
 
-void Runtime::createService(Session *session)
+void Runtime::syncService()
 {
-    const string p = session->getPath();
     map<string, list<int>> comm_pids;
 
-    Cgroup::iterateDir(comm_pids, p);
+    if (!m_session.m_cgroupMonitor)
+        return;
 
-    /* Destroy previous service list */
-    for (auto &svc:m_services)
-        delete svc;
-    m_services.clear();
+    m_session.m_cgroupMonitor->getTree().getPids(comm_pids);
 
-    /* Create service list again */
+    /* Update existing services, keeping PSS of remaining pids */
+    auto it = m_services.begin();
+    while (it != m_services.end()) {
+        auto mcp = comm_pids.find((*it)->getServiceId());
+        if (mcp == comm_pids.end()) {
+            delete (*it);
+            it = m_services.erase(it);
+            continue;
+        }
+
+        map<int, unsigned long>& pidPss = (*it)->getPidPss();
+        map<int, unsigned long> synced;
+        for (int pid : mcp->second) {
+            auto pp = pidPss.find(pid);
+            synced.insert(make_pair(pid, pp != pidPss.end() ? pp->second : 0));
+        }
+        pidPss.swap(synced);
+
+        comm_pids.erase(mcp);
+        ++it;
+    }
+
+    /* Create services which are newly populated */
     for (const auto& mcp : comm_pids) {
-        string comm = mcp.first;
-        list<int> pids = mcp.second;
-        Service* svc = new Service(comm, pids);
+        Service* svc = new Service(mcp.first, mcp.second);
         addService(svc);
     }
 
@@ -303,23 +720,34 @@ void Runtime::printService()
         (*it)->print();
 }
 
+string Runtime::makeAppKey(const string& appId, const string& instanceId)
+{
+    return appId + '\n' + instanceId;
+}
+
+/* Keep m_foregroundBegin valid before <it> is moved or removed */
+void Runtime::unlinkForeground(list<Application>::iterator it)
+{
+    if (it == m_foregroundBegin)
+        ++m_foregroundBegin;
+}
+
 void Runtime::addApp(Application& app)
 {
-    list<Application>::reverse_iterator insertPos = findFirstForeground();
+    const string key = makeAppKey(app.getAppId(), app.getInstanceId());
+    list<Application>::iterator it;
+
+    if (m_appIndex.find(key) != m_appIndex.end())
+        return;
 
-    if (app.getStatus() == "foreground") {
-        m_applications.push_back(app);
+    if (app.isForeground()) {
+        it = m_applications.insert(m_applications.end(), app);
+        if (m_foregroundBegin == m_applications.end())
+            m_foregroundBegin = it;
     } else {
-        if (insertPos != m_applications.rend()) {
-            if (m_applications.size() == 1) {
-                m_applications.push_front(app);
-            } else {
-                m_applications.insert(--insertPos.base(), app);
-            }
-        } else {
-            m_applications.push_back(app);
-        }
+        it = m_applications.insert(m_foregroundBegin, app);
     }
+    m_appIndex.insert(make_pair(key, it));
 
     MemoryManager* mm = MemoryManager::getInstance();
     mm->handleRuntimeChange(app.getAppId(), app.getInstanceId(),
@@ -329,59 +757,50 @@ void Runtime::addApp(Application& app)
 bool Runtime::updateApp(const string& appId, const string& instanceId,
                         const string& event)
 {
-    auto it = m_applications.begin();
-    for (; it != m_applications.end(); ++it) {
-        if (it->getAppId() == appId && it->getInstanceId() == instanceId)
-            break;
-    }
-
-    if (it == m_applications.end())
+    auto index = m_appIndex.find(makeAppKey(appId, instanceId));
+    if (index == m_appIndex.end())
         return false;
 
+    list<Application>::iterator it = index->second;
     enum RuntimeChange change;
 
+    if (it->isForeground())
+        unlinkForeground(it);
+
+    if (it->isFrozen() && event != "background")
+        thawCgroup(it->getFrozenPath());
+
     if (event == "stop") {
-        m_applications.remove(*it);
+        m_appIndex.erase(index);
+        m_applications.erase(it);
         change = RuntimeChange::APP_REMOVE;
     } else {
-        if (event == "foreground") {
+        it->setStatus(event);
+
+        if (it->isForeground()) {
             m_applications.splice(m_applications.end(), m_applications, it);
+            if (m_foregroundBegin == m_applications.end())
+                m_foregroundBegin = it;
         } else {
-            list<Application>::reverse_iterator rit = findFirstForeground();
-            m_applications.splice(--rit.base(), m_applications, it);
+            /* Most recently used background app */
+            m_applications.splice(m_foregroundBegin, m_applications, it);
         }
 
-        it->setStatus(event);
         change = RuntimeChange::APP_UPDATE;
     }
 
     MemoryManager* mm = MemoryManager::getInstance();
-    mm->handleRuntimeChange(it->getAppId(), it->getInstanceId(), change);
+    mm->handleRuntimeChange(appId, instanceId, change);
     return true;
 }
 
-list<Application>::reverse_iterator Runtime::findFirstForeground()
-{
-    list<Application>::reverse_iterator rit = m_applications.rbegin();
-    for (; rit != m_applications.rend(); ++rit) {
-        if (rit->getStatus() == "foreground") {
-            break;
-        }
-    }
-
-    return rit;
-}
-
 const string Runtime::findFirstForegroundAppId()
 {
-    list<Application>::reverse_iterator rit = m_applications.rbegin();
-    for (; rit != m_applications.rend(); ++rit) {
-        if (rit->getStatus() == "foreground") {
-            return rit->getAppId();
-        }
-    }
+    if (m_foregroundBegin == m_applications.end())
+        return "";
 
-    return "";
+    /* Most recently used foreground app */
+    return m_applications.back().getAppId();
 }
 
 int Runtime::countApp()
@@ -406,17 +825,31 @@ void Runtime::printApp()
 
 void Runtime::setAppDefaultStatus(const string& foregroundAppId)
 {
-    for (auto it = m_applications.begin(); it != m_applications.end(); ++it) {
-        if (it->getAppId() == foregroundAppId)
+    auto it = m_applications.begin();
+    m_foregroundBegin = m_applications.end();
+
+    /* Move foreground apps to the tail, keeping relative order */
+    for (size_t count = m_applications.size(); count > 0; --count) {
+        auto next = std::next(it);
+
+        if (it->getAppId() == foregroundAppId) {
             it->setStatus("foreground");
-        else
+            m_applications.splice(m_applications.end(), m_applications, it);
+            if (m_foregroundBegin == m_applications.end())
+                m_foregroundBegin = it;
+        } else {
             it->setStatus("background");
+        }
+
+        it = next;
     }
 }
 
-Runtime::Runtime(Session &session):m_session(session)
+Runtime::Runtime(Session &session)
+    : m_session(session)
 {
     setClassName("Runtime");
+    m_foregroundBegin = m_applications.end();
 }
 
 Runtime::~Runtime()
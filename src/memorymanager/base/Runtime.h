@@ -19,9 +19,14 @@
 
 #include <iostream>
 #include <list>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <session/Session.h>
 
+#include "base/PssCollector.h"
+#include "base/VictimScorer.h"
+
 #include "interface/IClassName.h"
 #include "interface/IPrintable.h"
 
@@ -32,9 +37,14 @@ public:
     explicit BaseProcess() = default;
     virtual ~BaseProcess() { }
 
-    long getPssValue(const int pid);
+    virtual void updateMemStat(PssCollector& collector) = 0;
+};
 
-    virtual void updateMemStat() = 0;
+/* Status of application which decides its position in LRU list */
+enum class AppStatus : char {
+    OTHER = 0,      // launch, splash, ... any other event of SAM
+    FOREGROUND,
+    BACKGROUND,
 };
 
 class Application : public BaseProcess,
@@ -53,10 +63,25 @@ public:
     const string& getInstanceId() const { return m_instanceId; }
     const string& getAppId() const { return m_appId; }
     const string& getStatus() const { return m_status; }
+    AppStatus getAppStatus() const { return m_appStatus; }
+    bool isForeground() const { return m_appStatus == AppStatus::FOREGROUND; }
+    const string& getType() const { return m_type; }
+    int getPid() const { return m_pid; }
+    unsigned long getPssKb() const { return m_pssKb; }
+    unsigned long getUssKb() const { return m_ussKb; }
+    unsigned long getSwapKb() const { return m_swapKb; }
+    int getOomScoreAdj() const { return m_oomScoreAdj; }
+    long long getStatusTime() const { return m_statusTime; }
+    bool isFrozen() const { return !m_frozenPath.empty(); }
+    const string& getFrozenPath() const { return m_frozenPath; }
+    void setFrozenPath(const string& path) { m_frozenPath = path; }
+    int getAdvice() const { return m_advice; }
+    void setAdvice(int advice) { m_advice = advice; }
+    bool takeLaunchPeak(unsigned long& peakKb);
 
     bool operator==(const Application& compare);
 
-    virtual void updateMemStat() override final;
+    virtual void updateMemStat(PssCollector& collector) override final;
 
     // IPrintable
     virtual void print() override final;
@@ -67,8 +92,19 @@ private:
     const string m_appId;       // name of application
     string m_type;              // type of application (web, native, ...)
     string m_status;            // status or event of application (FG, BG, ...)
+    AppStatus m_appStatus;      // m_status which is parsed once
     int m_pid;                  // Linux PID
+    unsigned long m_rssKb;      // RSS in KB size
     unsigned long m_pssKb;      // PSS in KB size
+    unsigned long m_ussKb;      // USS in KB size
+    unsigned long m_swapKb;     // SwapPss in KB size
+    int m_oomScoreAdj;          // oom_score_adj
+    long long m_pssTime;        // when m_pssKb is read, ms monotonic
+    long long m_statusTime;     // when m_status is changed, ms monotonic
+    string m_frozenPath;        // cgroup frozen for this app, empty if not frozen
+    int m_advice;               // MADV_COLD or MADV_PAGEOUT given in background, 0 if none
+    long long m_launchTime;     // when pid is given after launch, 0 if not learning
+    unsigned long m_launchPeakKb;   // peak PSS since m_launchTime
 };
 
 class Service : public BaseProcess,
@@ -84,7 +120,7 @@ public:
     template<typename T, typename U>
     void toString(map<T, U>& pMap, string& str1, string& str2);
 
-    virtual void updateMemStat() override final;
+    virtual void updateMemStat(PssCollector& collector) override final;
 
     // IPrintable
     virtual void print() override final;
@@ -95,6 +131,7 @@ private:
     map<int, unsigned long> m_pidPss;   // Linux PID and PSS in KB size,
                                         // Service Class may have multiple PIDs and PSS,
                                         // While Application has only one PID and PSS.
+    long long m_pssTime;                // when oldest PSS of m_pidPss is read
 };
 
 enum class RuntimeChange : char {
@@ -109,8 +146,15 @@ public:
     explicit Runtime(Session& session);
     virtual ~Runtime();
 
+    void getPids(vector<int>& pids) const;
     void updateMemStat();
     bool reclaimMemory(bool critical);
+    bool reclaimMemory(bool critical, unsigned long& targetKb);
+    unsigned long reclaimBackground(unsigned long& targetKb);
+    int freezeIdleApps();
+    unsigned long pageoutBackground(unsigned long& targetKb);
+    void getVictimCandidates(bool critical, vector<VictimCandidate>& candidates);
+    bool closeApp(const string& appId, const string& instanceId);
 
     /* Reserved Pid List Management */
     void clearReservedPid();
@@ -119,17 +163,17 @@ public:
     /* Service List Management */
     void addService(Service* service);
     void updateService(const string& serviceId, const int pid);
-    void createService(Session *sesssion);
+    void syncService();
     int countService();
     void printService();
     void printService(JValue& json);
 
     /* Application List Management */
+    static string makeAppKey(const string& appId, const string& instanceId);
     bool updateApp(const string& appId, const string& instanceId,
                    const string& event);
     void addApp(Application& app);
     int countApp();
-    list<Application>::reverse_iterator findFirstForeground();
     const string findFirstForegroundAppId();
     void printApp();
     void printApp(JValue& json);
@@ -139,11 +183,25 @@ private:
     static const string WAM_SERVICE_ID;
     static const string SAM_SERVICE_ID;
 
+    unsigned long reclaimCgroup(const string& path, unsigned long targetKb);
+    void getBackgroundCgroups(unordered_set<string>& paths);
+    void thawCgroup(const string& path);
+
     Session& m_session;
 
     list<int> m_reservedPids;
     list<Service*> m_services;
+
+    /*
+     * Applications in LRU order, background apps first and foreground apps
+     * at the tail. m_appIndex finds an app by makeAppKey() and
+     * m_foregroundBegin is the first foreground app (end() if none), so that
+     * each lifecycle event is handled without scanning the list.
+     */
     list<Application> m_applications;
+    unordered_map<string, list<Application>::iterator> m_appIndex;
+    list<Application>::iterator m_foregroundBegin;
+    void unlinkForeground(list<Application>::iterator it);
 };
 
 #endif /* BASE_RUNTIME_H_ */
@@ -0,0 +1,106 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <limits.h>
+
+#include "base/VictimPlanner.h"
+
+#include "util/Logger.h"
+
+unsigned long VictimPlanner::getFreeable(const VictimCandidate& c, float swapRatio)
+{
+    unsigned long freeable = c.ussKb ? c.ussKb : c.pssKb;
+
+    if (swapRatio > 0.0f)
+        freeable += (unsigned long)(c.swapKb / swapRatio);
+    return freeable;
+}
+
+/*
+ * 0/1 covering knapsack over memory buckets. cost[i][j] is the minimum cost
+ * of the first i candidates to free j buckets, where j is capped at deficit.
+ */
+bool VictimPlanner::plan(const vector<VictimCandidate>& candidates, unsigned long deficitKb,
+                         float swapRatio, vector<VictimCandidate>& victims)
+{
+    const int INF = INT_MAX / 2;
+    size_t n = candidates.size();
+    int minScore = INT_MAX, maxScore = INT_MIN;
+
+    victims.clear();
+    if (deficitKb == 0 || n == 0)
+        return deficitKb == 0;
+
+    for (const VictimCandidate& c : candidates) {
+        minScore = min(minScore, c.score);
+        maxScore = max(maxScore, c.score);
+    }
+
+    /* Bucket is at least 1MB, larger for big deficit to bound the table */
+    unsigned long unitKb = max(1024UL, (deficitKb + MAX_BUCKETS - 1) / MAX_BUCKETS);
+    int d = (int)((deficitKb + unitKb - 1) / unitKb);
+
+    vector<int> weight(n), cost(n);
+    for (size_t i = 0; i < n; ++i) {
+        weight[i] = (int)min((unsigned long)d, getFreeable(candidates[i], swapRatio) / unitKb);
+        cost[i] = KILL_COST + (maxScore - candidates[i].score) * 100 / max(maxScore - minScore, 1);
+    }
+
+    vector<vector<int>> table(n + 1, vector<int>(d + 1, INF));
+    table[0][0] = 0;
+    for (size_t i = 1; i <= n; ++i) {
+        table[i] = table[i - 1];
+        for (int j = 0; j <= d; ++j) {
+            if (table[i - 1][j] == INF)
+                continue;
+
+            int next = min(d, j + weight[i - 1]);
+            table[i][next] = min(table[i][next], table[i - 1][j] + cost[i - 1]);
+        }
+    }
+
+    if (table[n][d] == INF) {
+        Logger::normal("Deficit " + to_string(deficitKb) + " kb is larger than all candidates",
+                       getClassName());
+        victims = candidates;
+        return false;
+    }
+
+    /* Trace back which candidates are taken */
+    int j = d;
+    for (size_t i = n; i > 0 && j > 0; --i) {
+        if (table[i][j] == table[i - 1][j])
+            continue;
+
+        for (int prev = max(0, j - weight[i - 1]); prev <= j; ++prev) {
+            if (table[i - 1][prev] != INF &&
+                min(d, prev + weight[i - 1]) == j &&
+                table[i - 1][prev] + cost[i - 1] == table[i][j]) {
+                victims.push_back(candidates[i - 1]);
+                j = prev;
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+VictimPlanner::VictimPlanner()
+{
+    setClassName("VictimPlanner");
+}
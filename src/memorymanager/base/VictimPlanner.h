@@ -0,0 +1,50 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef BASE_VICTIMPLANNER_H_
+#define BASE_VICTIMPLANNER_H_
+
+#include <vector>
+
+#include "base/VictimScorer.h"
+#include "interface/IClassName.h"
+
+using namespace std;
+
+/*
+ * Picks the cheapest set of victims which covers a memory deficit, so that
+ * all of them are closed at once instead of one by one with waits.
+ * Each close costs a base cost, which keeps the set small, and a part of
+ * its score, which spares apps that VictimScorer ranked low.
+ */
+class VictimPlanner : public IClassName {
+public:
+    explicit VictimPlanner();
+    virtual ~VictimPlanner() {}
+
+    /* Returns false if all candidates do not cover it, <victims> has all of them then */
+    bool plan(const vector<VictimCandidate>& candidates, unsigned long deficitKb,
+              float swapRatio, vector<VictimCandidate>& victims);
+
+    /* Memory freed by closing it. Swap in zram frees its compressed size */
+    static unsigned long getFreeable(const VictimCandidate& c, float swapRatio);
+
+private:
+    static const int KILL_COST = 100;
+    static const int MAX_BUCKETS = 1024;
+};
+
+#endif /* BASE_VICTIMPLANNER_H_ */
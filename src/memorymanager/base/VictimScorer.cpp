@@ -0,0 +1,55 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+
+#include "base/VictimScorer.h"
+#include "setting/SettingManager.h"
+
+static int normalize(unsigned long value, unsigned long max)
+{
+    return max ? (int)(value * 100 / max) : 0;
+}
+
+void WeightedVictimScorer::score(vector<VictimCandidate>& candidates)
+{
+    unsigned long maxUss = 0, maxSwap = 0;
+    int lruCount = (int)candidates.size();
+
+    for (const VictimCandidate& c : candidates) {
+        maxUss = max(maxUss, c.ussKb ? c.ussKb : c.pssKb);
+        maxSwap = max(maxSwap, c.swapKb);
+    }
+
+    for (VictimCandidate& c : candidates) {
+        int age = (lruCount > 1) ? (lruCount - 1 - c.lruRank) * 100 / (lruCount - 1) : 100;
+        int size = normalize(c.ussKb ? c.ussKb : c.pssKb, maxUss);
+        int swap = normalize(c.swapKb, maxSwap);
+        int oom = (min(max(c.oomScoreAdj, -1000), 1000) + 1000) / 20;
+        int web = c.web ? 100 : 0;
+
+        c.score = SettingManager::getVictimWeightAge() * age +
+                  SettingManager::getVictimWeightSize() * size +
+                  SettingManager::getVictimWeightSwap() * swap +
+                  SettingManager::getVictimWeightOom() * oom +
+                  SettingManager::getVictimWeightWeb() * web;
+    }
+}
+
+WeightedVictimScorer::WeightedVictimScorer()
+{
+    setClassName("WeightedVictimScorer");
+}
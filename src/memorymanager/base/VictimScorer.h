@@ -0,0 +1,68 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef BASE_VICTIMSCORER_H_
+#define BASE_VICTIMSCORER_H_
+
+#include <vector>
+
+#include "interface/IClassName.h"
+
+using namespace std;
+
+class Application;
+class Runtime;
+
+/* Features of a background app which may be closed to reclaim memory */
+struct VictimCandidate {
+    Runtime* runtime;
+    Application* app;
+    int lruRank;                // 0 for least recently used
+    unsigned long pssKb;
+    unsigned long ussKb;        // what is freed by closing it
+    unsigned long swapKb;
+    int oomScoreAdj;
+    bool web;
+    bool foreground;
+    int score;                  // higher is closed first
+};
+
+/*
+ * Ranks victim candidates. Features are cached on Application by
+ * Runtime::updateMemStat, so scoring does not read any file. Replace the
+ * default scorer with MemoryManager::setVictimScorer().
+ */
+class VictimScorer : public IClassName {
+public:
+    explicit VictimScorer() = default;
+    virtual ~VictimScorer() {}
+
+    virtual void score(vector<VictimCandidate>& candidates) = 0;
+};
+
+/*
+ * Weighted sum of features which are normalized to 0..100 among candidates.
+ * Weights are "victim" in memorymanager.json.
+ */
+class WeightedVictimScorer : public VictimScorer {
+public:
+    explicit WeightedVictimScorer();
+    virtual ~WeightedVictimScorer() {}
+
+    virtual void score(vector<VictimCandidate>& candidates) override;
+};
+
+#endif /* BASE_VICTIMSCORER_H_ */
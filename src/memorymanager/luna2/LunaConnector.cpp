@@ -138,6 +138,7 @@ LunaSubscriber::~LunaSubscriber()
 LSMethod LunaServiceProvider::methods[] = {
     {"requireMemory", LunaServiceProvider::requireMemory, LUNA_METHOD_FLAGS_NONE},
     {"getMemoryStatus", LunaServiceProvider::getMemoryStatus, LUNA_METHOD_FLAGS_NONE},
+    {"getMemoryHistory", LunaServiceProvider::getMemoryHistory, LUNA_METHOD_FLAGS_NONE},
     {"getManagerEvent", LunaServiceProvider::getManagerEvent, LUNA_METHOD_FLAGS_NONE},
     {nullptr, nullptr}
 };
@@ -158,21 +159,36 @@ bool LunaServiceProvider::requireMemory(LSHandle* sh, LSMessage* msg, void* ctxt
 
     /* Request handling */
     int requiredMemory = 0;
-    bool relaunch = false;
-    bool returnValue = true;
-    string errorText = "";
 
     if (!JValueUtil::getValue(requestPayload, "requiredMemory", requiredMemory)) {
         int err = 3;
         responsePayload.put("errorCode", err);
         responsePayload.put("errorText", errorCode[err]);
-        returnValue = false;
-        goto out;
+        responsePayload.put("returnValue", false);
+
+        LunaLogger::logResponse(request, responsePayload, mm->getServiceName());
+
+        request.respond(responsePayload.stringify().c_str());
+        return true;
     }
 
-    returnValue = MemoryManager::getInstance()->onRequireMemory(requiredMemory, errorText);
+    /* Optional, to release the reservation when the app runs and to queue */
+    string appId = "";
+    int priority = 0;
+    JValueUtil::getValue(requestPayload, "appId", appId);
+    JValueUtil::getValue(requestPayload, "priority", priority);
+
+    /* Responded by respondRequireMemory(), maybe after memory is reclaimed */
+    mm->onRequireMemory(requiredMemory, appId, priority, request);
+    return true;
+}
+
+void LunaServiceProvider::respondRequireMemory(Message& request, bool returnValue,
+                                               const string& errorText)
+{
+    MemoryManager* mm = MemoryManager::getInstance();
+    JValue responsePayload = pbnjson::Object();
 
-out:
     if (errorText != "")
         responsePayload.put("errorText", errorText);
 
@@ -181,7 +197,6 @@ out:
     LunaLogger::logResponse(request, responsePayload, mm->getServiceName());
 
     request.respond(responsePayload.stringify().c_str());
-    return true;
 }
 
 bool LunaServiceProvider::getMemoryStatus(LSHandle* sh, LSMessage* msg, void* ctxt)
@@ -211,6 +226,39 @@ bool LunaServiceProvider::getMemoryStatus(LSHandle* sh, LSMessage* msg, void* ct
     return true;
 }
 
+bool LunaServiceProvider::getMemoryHistory(LSHandle*, LSMessage* msg, void*)
+{
+    MemoryManager* mm = MemoryManager::getInstance();
+
+    Message request(msg);
+    JValue requestPayload = JDomParser::fromString(request.getPayload());
+    JValue responsePayload = pbnjson::Object();
+    LunaLogger::logRequest(request, requestPayload, mm->getServiceName());
+
+    /* Request handling */
+    int count = 0;
+    bool returnValue = true;
+
+    JValueUtil::getValue(requestPayload, "count", count);
+    if (count < 0) {
+        int err = 4;
+        responsePayload.put("errorCode", err);
+        responsePayload.put("errorText", errorCode[err]);
+        returnValue = false;
+    } else {
+        mm->printHistory(responsePayload, count);
+    }
+
+    responsePayload.put("returnValue", returnValue);
+
+    /* History can be long, so do not log whole response */
+    Logger::normal("[Response] API(" + string(request.getMethod()) +
+                   ") Client(" + string(request.getSenderServiceName()) + ")",
+                   mm->getServiceName());
+    request.respond(responsePayload.stringify().c_str());
+    return true;
+}
+
 bool LunaServiceProvider::getManagerEvent(LSHandle* sh, LSMessage* msg, void* ctxt)
 {
     LunaServiceProvider *p = static_cast<LunaServiceProvider*>(ctxt);
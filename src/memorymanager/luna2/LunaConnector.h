@@ -57,6 +57,7 @@ public:
     void raiseSignalLevelChanged(const string& prev, const string& cur);
     void postMemoryStatus();
     void postManagerEventKilling(const string& appId, const string& instanceId);
+    void respondRequireMemory(Message& request, bool returnValue, const string& errorText);
 
 #ifdef SUPPORT_LEGACY_API
     void raiseSignalThresholdChanged(const string& prev, const string& cur);
@@ -71,6 +72,7 @@ private:
 
     static bool requireMemory(LSHandle* sh, LSMessage* msg, void* ctxt);
     static bool getMemoryStatus(LSHandle* sh, LSMessage* msg, void* ctxt);
+    static bool getMemoryHistory(LSHandle* sh, LSMessage* msg, void* ctxt);
     static bool getManagerEvent(LSHandle* sh, LSMessage* msg, void* ctxt);
 
 #ifdef SUPPORT_LEGACY_API
@@ -0,0 +1,69 @@
+// Copyright (c) 2020 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "memorymonitor/MemoryHistory.h"
+
+void MemoryHistory::push(const MemorySample& sample)
+{
+    unsigned long index = m_head.load(memory_order_relaxed);
+    Slot& slot = m_slots[index % CAPACITY];
+
+    slot.seq.store(2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot.sample = sample;
+    slot.seq.store(2 * index + 2, memory_order_release);
+
+    m_head.store(index + 1, memory_order_release);
+}
+
+int MemoryHistory::read(MemorySample* samples, int count) const
+{
+    unsigned long head = m_head.load(memory_order_acquire);
+    unsigned long n = (unsigned long)count;
+    int copied = 0;
+
+    if (count <= 0)
+        return 0;
+    if (n > head)
+        n = head;
+    if (n > CAPACITY)
+        n = CAPACITY;
+
+    for (unsigned long index = head - n; index < head; ++index) {
+        const Slot& slot = m_slots[index % CAPACITY];
+
+        if (slot.seq.load(memory_order_acquire) != 2 * index + 2)
+            continue;
+
+        samples[copied] = slot.sample;
+        atomic_thread_fence(memory_order_acquire);
+
+        /* Overwritten by writer while copying */
+        if (slot.seq.load(memory_order_relaxed) != 2 * index + 2)
+            continue;
+
+        copied++;
+    }
+
+    return copied;
+}
+
+MemoryHistory::MemoryHistory()
+    : m_head(0)
+{
+    for (int i = 0; i < CAPACITY; ++i)
+        m_slots[i].seq.store(0, memory_order_relaxed);
+}
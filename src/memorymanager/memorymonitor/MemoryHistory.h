@@ -0,0 +1,61 @@
+// Copyright (c) 2020 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef MEMORYMONITOR_MEMORYHISTORY_H_
+#define MEMORYMONITOR_MEMORYHISTORY_H_
+
+#include <atomic>
+
+using namespace std;
+
+struct MemorySample {
+    long long time;         // ms, monotonic
+    long total;             // MB
+    long available;         // MB
+    long swapUsed;          // MB
+    float psiSomeAvg10;
+    float psiFullAvg10;
+    char level[16];
+};
+
+/*
+ * Fixed-capacity ring buffer of MemorySample. Only one thread pushes, and
+ * readers never block it. Each slot carries a sequence number, so that a
+ * reader drops the slot which is being overwritten while it copies.
+ */
+class MemoryHistory {
+public:
+    static const int CAPACITY = 512;
+
+    explicit MemoryHistory();
+    virtual ~MemoryHistory() {}
+
+    void push(const MemorySample& sample);
+
+    /* Copy up to <count> latest samples, oldest first. Return copied count */
+    int read(MemorySample* samples, int count) const;
+
+private:
+    struct Slot {
+        atomic<unsigned long> seq;  // 2 * index + 1 while writing, + 2 after
+        MemorySample sample;
+    };
+
+    Slot m_slots[CAPACITY];
+    atomic<unsigned long> m_head;   // number of pushed samples
+};
+
+#endif /* MEMORYMONITOR_MEMORYHISTORY_H_ */
@@ -16,16 +16,31 @@
 
 #include "MemoryMonitor.h"
 #include "MemoryManager.h"
+#include "memorymonitor/SamplerMonitor.h"
+#include "session/Session.h"
+
+#include "setting/SettingManager.h"
 
 #include "util/Logger.h"
 #include "util/Proc.h"
+#include "util/Time.h"
+
+#include <glib-unix.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+const char* const PsiMonitor::PSI_MEMORY = "/proc/pressure/memory";
 
 void AvailMemMonitor::initSource(GMainLoop* loop)
 {
     GMainContext* gCtxt = g_main_loop_get_context(loop);
     gpointer gptr = (gpointer)this;
 
-    m_source = g_timeout_source_new_seconds(m_updatePeriod);
+    m_source = g_timeout_source_new(m_updatePeriod);
     g_source_set_callback(m_source, MonitorEvent::onSourceCallback, gptr, NULL);
     m_sourceId = g_source_attach(m_source, gCtxt);
 }
@@ -36,20 +51,58 @@ void AvailMemMonitor::deinitSource()
     g_source_unref(m_source);
 }
 
+/*
+ * Sample slowly deep in normal level and fast near low level. If available
+ * memory is falling, sample often enough to see the low level coming.
+ */
+int AvailMemMonitor::nextUpdatePeriod(long available, long dropRate)
+{
+    const long minPeriod = SettingManager::getSamplingMinPeriod();
+    const long maxPeriod = SettingManager::getSamplingMaxPeriod();
+    const long band = SettingManager::getSamplingBand();
+    long headroom = available - SettingManager::getMemoryLevelLowEnter();
+    long period;
+
+    if (headroom <= 0)
+        return minPeriod;
+
+    if (band <= 0 || headroom >= band)
+        period = maxPeriod;
+    else
+        period = minPeriod + (maxPeriod - minPeriod) * headroom / band;
+
+    /* Take 4 samples at least before reaching low level with current drop rate */
+    if (dropRate > 0)
+        period = min(period, headroom * 1000 / dropRate / 4);
+
+    /* Round to 50ms not to recreate timer for small difference */
+    period = (period / 50) * 50;
+
+    return (int)max(minPeriod, min(maxPeriod, period));
+}
+
 void AvailMemMonitor::update(void)
 {
-    map<string, string> mInfo;
+    MemInfoSnapshot mInfo;
 
-    Proc::getMemInfo(mInfo);
+    if (!Proc::getMemInfo(mInfo))
+        return;
 
-    auto it = mInfo.find("MemTotal");
-    if (it != mInfo.end()) {
-        m_total = stoul(it->second) / 1024;
-    }
+    m_total = mInfo.memTotal / 1024;
+    m_available = mInfo.memAvailable / 1024;
+    m_swapUsed = (mInfo.swapTotal - mInfo.swapFree) / 1024;
 
-    it = mInfo.find("MemAvailable");
-    if (it != mInfo.end()) {
-        m_available = stoul(it->second) / 1024;
+    /* MB per second */
+    m_trend.addSample(Time::getSystemTimeMs(), (long)m_available);
+    long dropRate = (long)-m_trend.getSlope();
+
+    int period = nextUpdatePeriod((long)m_available, dropRate);
+    if (period != m_updatePeriod) {
+        Logger::verbose("Update period changed from " + to_string(m_updatePeriod) +
+                        "ms to " + to_string(period) + "ms", "AvailMemMonitor");
+        m_updatePeriod = period;
+        deinitSource();
+        initSource(m_loop);
     }
 
     this->m_memoryMonitor.raiseEvent((MonitorEvent&)*this);
@@ -61,7 +114,12 @@ long AvailMemMonitor::getAvailable(void)
 }
 
 AvailMemMonitor::AvailMemMonitor(MemoryMonitor& monitor, GMainLoop* loop)
-    : m_memoryMonitor(monitor)
+    : m_updatePeriod(SettingManager::getSamplingMinPeriod()),
+      m_total(0),
+      m_available(0),
+      m_swapUsed(0),
+      m_loop(loop),
+      m_memoryMonitor(monitor)
 {
     initSource(loop);
 }
@@ -71,6 +129,516 @@ AvailMemMonitor::~AvailMemMonitor()
     deinitSource();
 }
 
+/* Register PSI trigger "<type> <threshold> <window>", one trigger per fd */
+int PsiMonitor::openTrigger(const string& path, const char* type,
+                            int threshold, int window)
+{
+    char trigger[64];
+    int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+
+    if (fd < 0) {
+        Logger::warning("Fail to open " + path + ": " +
+                        string(strerror(errno)), "PsiMonitor");
+        return -1;
+    }
+
+    int len = snprintf(trigger, sizeof(trigger), "%s %d %d", type, threshold, window);
+    if (write(fd, trigger, len + 1) < 0) {
+        Logger::warning("Fail to register PSI trigger (" + string(trigger) +
+                        "): " + string(strerror(errno)), "PsiMonitor");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+gboolean PsiMonitor::onTrigger(gint fd, GIOCondition condition, gpointer data)
+{
+    PsiMonitor *p = static_cast<PsiMonitor *>(data);
+
+    if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) {
+        Logger::error("PSI trigger is not available anymore", "PsiMonitor");
+        return G_SOURCE_REMOVE;
+    }
+
+    p->m_stall = (fd == p->m_fd[(int)Stall::FULL]) ? Stall::FULL : Stall::SOME;
+    p->update();
+    return G_SOURCE_CONTINUE;
+}
+
+void PsiMonitor::initSource(GMainLoop* loop)
+{
+    GMainContext* gCtxt = g_main_loop_get_context(loop);
+    gpointer gptr = (gpointer)this;
+
+    m_fd[(int)Stall::SOME] = openTrigger(PSI_MEMORY, "some",
+                                         SettingManager::getPsiSomeThreshold(),
+                                         SettingManager::getPsiWindow());
+    m_fd[(int)Stall::FULL] = openTrigger(PSI_MEMORY, "full",
+                                         SettingManager::getPsiFullThreshold(),
+                                         SettingManager::getPsiWindow());
+
+    for (int i = 0; i < 2; ++i) {
+        if (m_fd[i] < 0)
+            continue;
+
+        m_sources[i] = g_unix_fd_source_new(m_fd[i], G_IO_PRI);
+        g_source_set_callback(m_sources[i], (GSourceFunc)G_CALLBACK(PsiMonitor::onTrigger), gptr, NULL);
+        g_source_attach(m_sources[i], gCtxt);
+    }
+}
+
+void PsiMonitor::deinitSource()
+{
+    for (int i = 0; i < 2; ++i) {
+        if (m_sources[i]) {
+            g_source_destroy(m_sources[i]);
+            g_source_unref(m_sources[i]);
+            m_sources[i] = nullptr;
+        }
+
+        if (m_fd[i] >= 0) {
+            close(m_fd[i]);
+            m_fd[i] = -1;
+        }
+    }
+}
+
+void PsiMonitor::update()
+{
+    Proc::getMemPressure(m_pressure);
+
+    this->m_memoryMonitor.raiseEvent((MonitorEvent&)*this);
+}
+
+bool PsiMonitor::isAvailable() const
+{
+    return m_fd[(int)Stall::SOME] >= 0 || m_fd[(int)Stall::FULL] >= 0;
+}
+
+PsiMonitor::PsiMonitor(MemoryMonitor& monitor, GMainLoop* loop)
+    : m_stall(Stall::SOME),
+      m_memoryMonitor(monitor)
+{
+    m_fd[0] = m_fd[1] = -1;
+    m_sources[0] = m_sources[1] = nullptr;
+    memset(&m_pressure, 0, sizeof(m_pressure));
+
+    initSource(loop);
+}
+
+PsiMonitor::~PsiMonitor()
+{
+    deinitSource();
+}
+
+gboolean MemcgMonitor::onEvents(gint fd, GIOCondition, gpointer data)
+{
+    MemcgMonitor *p = static_cast<MemcgMonitor *>(data);
+    char buf[sizeof(struct inotify_event) + NAME_MAX + 1];
+
+    /* Drain pending notifications, memory.events is read once below */
+    while (read(fd, buf, sizeof(buf)) > 0);
+
+    p->m_pressured = false;
+    p->update();
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean MemcgMonitor::onPressure(gint, GIOCondition condition, gpointer data)
+{
+    MemcgMonitor *p = static_cast<MemcgMonitor *>(data);
+
+    /* cgroup was removed */
+    if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL))
+        return G_SOURCE_REMOVE;
+
+    p->m_pressured = true;
+    p->update();
+    return G_SOURCE_CONTINUE;
+}
+
+void MemcgMonitor::initSource(GMainLoop* loop)
+{
+    GMainContext* gCtxt = g_main_loop_get_context(loop);
+    gpointer gptr = (gpointer)this;
+    const string& path = m_session.getPath();
+    const string events = path + "/" + Cgroup::MEMORY_EVENTS;
+
+    if (!Cgroup::getMemoryEvents(path, m_eventsFd, m_events)) {
+        Logger::warning("No memcg events for " + path, "MemcgMonitor");
+        return;
+    }
+
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0 && inotify_add_watch(m_inotifyFd, events.c_str(), IN_MODIFY) >= 0) {
+        m_inotifySource = g_unix_fd_source_new(m_inotifyFd, G_IO_IN);
+        g_source_set_callback(m_inotifySource, (GSourceFunc)G_CALLBACK(MemcgMonitor::onEvents), gptr, NULL);
+        g_source_attach(m_inotifySource, gCtxt);
+    } else {
+        Logger::warning("Fail to watch " + events + ": " + string(strerror(errno)), "MemcgMonitor");
+    }
+
+    m_pressureFd = PsiMonitor::openTrigger(path + "/" + Cgroup::MEMORY_PRESSURE, "some",
+                                           SettingManager::getPsiSomeThreshold(),
+                                           SettingManager::getPsiWindow());
+    if (m_pressureFd >= 0) {
+        m_pressureSource = g_unix_fd_source_new(m_pressureFd, G_IO_PRI);
+        g_source_set_callback(m_pressureSource, (GSourceFunc)G_CALLBACK(MemcgMonitor::onPressure), gptr, NULL);
+        g_source_attach(m_pressureSource, gCtxt);
+    }
+}
+
+void MemcgMonitor::deinitSource()
+{
+    GSource** sources[] = { &m_inotifySource, &m_pressureSource };
+    int* fds[] = { &m_inotifyFd, &m_eventsFd, &m_pressureFd };
+
+    for (GSource** source : sources) {
+        if (*source) {
+            g_source_destroy(*source);
+            g_source_unref(*source);
+            *source = nullptr;
+        }
+    }
+
+    for (int* fd : fds) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void MemcgMonitor::update()
+{
+    MemcgEvents prev = m_events;
+
+    if (!Cgroup::getMemoryEvents(m_session.getPath(), m_eventsFd, m_events))
+        return;
+
+    m_delta.low = m_events.low - prev.low;
+    m_delta.high = m_events.high - prev.high;
+    m_delta.max = m_events.max - prev.max;
+    m_delta.oom = m_events.oom - prev.oom;
+    m_delta.oomKill = m_events.oomKill - prev.oomKill;
+
+    /* "low" only means protection was breached, it is not a pressure */
+    if (!m_pressured && m_delta.high == 0 && m_delta.max == 0 &&
+        m_delta.oom == 0 && m_delta.oomKill == 0)
+        return;
+
+    this->m_memoryMonitor.raiseEvent((MonitorEvent&)*this);
+}
+
+MemcgMonitor::MemcgMonitor(MemoryMonitor& monitor, GMainLoop* loop,
+                           Session& session)
+    : m_inotifyFd(-1),
+      m_eventsFd(-1),
+      m_pressureFd(-1),
+      m_inotifySource(nullptr),
+      m_pressureSource(nullptr),
+      m_pressured(false),
+      m_session(session),
+      m_memoryMonitor(monitor)
+{
+    memset(&m_events, 0, sizeof(m_events));
+    memset(&m_delta, 0, sizeof(m_delta));
+
+    initSource(loop);
+}
+
+MemcgMonitor::~MemcgMonitor()
+{
+    deinitSource();
+}
+
+gboolean CgroupMonitor::onEvents(gint, GIOCondition, gpointer data)
+{
+    CgroupMonitor *p = static_cast<CgroupMonitor *>(data);
+
+    p->update();
+    return G_SOURCE_CONTINUE;
+}
+
+void CgroupMonitor::initSource(GMainLoop* loop)
+{
+    GMainContext* gCtxt = g_main_loop_get_context(loop);
+    gpointer gptr = (gpointer)this;
+
+    if (!m_tree.open(m_session.getPath()))
+        return;
+
+    m_source = g_unix_fd_source_new(m_tree.getFd(), G_IO_IN);
+    g_source_set_callback(m_source, (GSourceFunc)G_CALLBACK(CgroupMonitor::onEvents), gptr, NULL);
+    m_sourceId = g_source_attach(m_source, gCtxt);
+}
+
+void CgroupMonitor::deinitSource()
+{
+    if (m_source) {
+        g_source_destroy(m_source);
+        g_source_unref(m_source);
+        m_source = nullptr;
+    }
+
+    m_tree.close();
+}
+
+void CgroupMonitor::update()
+{
+    if (!m_tree.update())
+        return;
+
+    this->m_memoryMonitor.raiseEvent((MonitorEvent&)*this);
+}
+
+CgroupMonitor::CgroupMonitor(MemoryMonitor& monitor, GMainLoop* loop,
+                             Session& session)
+    : m_session(session),
+      m_memoryMonitor(monitor)
+{
+    m_source = nullptr;
+
+    initSource(loop);
+}
+
+CgroupMonitor::~CgroupMonitor()
+{
+    deinitSource();
+}
+
+void VmStatMonitor::initSource(GMainLoop* loop)
+{
+    GMainContext* gCtxt = g_main_loop_get_context(loop);
+    gpointer gptr = (gpointer)this;
+
+    m_source = g_timeout_source_new(SettingManager::getVmStatPeriod());
+    g_source_set_callback(m_source, MonitorEvent::onSourceCallback, gptr, NULL);
+    m_sourceId = g_source_attach(m_source, gCtxt);
+}
+
+void VmStatMonitor::deinitSource()
+{
+    g_source_destroy(m_source);
+    g_source_unref(m_source);
+}
+
+void VmStatMonitor::update()
+{
+    VmStatSnapshot cur;
+    long long now = Time::getSystemTimeMs();
+
+    if (!Proc::getVmStat(cur))
+        return;
+
+    if (m_updatedTime == 0 || now <= m_updatedTime) {
+        m_vmStat = cur;
+        m_updatedTime = now;
+        return;
+    }
+
+    long long elapsed = now - m_updatedTime;
+    unsigned long long scanned = cur.pgscan - m_vmStat.pgscan;
+    unsigned long long stolen = cur.pgsteal - m_vmStat.pgsteal;
+    unsigned long long refaults = (cur.refaultAnon - m_vmStat.refaultAnon) +
+                                  (cur.refaultFile - m_vmStat.refaultFile);
+
+    m_refaultRate = (long)(refaults * 1000 / elapsed);
+    m_swapInRate = (long)((cur.pswpin - m_vmStat.pswpin) * 1000 / elapsed);
+    m_swapOutRate = (long)((cur.pswpout - m_vmStat.pswpout) * 1000 / elapsed);
+    m_allocStallRate = (long)((cur.allocstall - m_vmStat.allocstall) * 1000 / elapsed);
+    m_reclaimEfficiency = (scanned == 0) ? 100 : (int)(stolen * 100 / scanned);
+
+    /* Pages come back as soon as reclaimed. Ignore a few refaults */
+    if (m_refaultRate < SettingManager::getVmStatRefaultFloor())
+        m_thrashingScore = 0;
+    else
+        m_thrashingScore = (int)min(100ULL, refaults * 100 / max(stolen, 1ULL));
+
+    m_vmStat = cur;
+    m_updatedTime = now;
+
+    this->m_memoryMonitor.raiseEvent((MonitorEvent&)*this);
+}
+
+void VmStatMonitor::print(JValue& json)
+{
+    JValue vmstat = pbnjson::Object();
+
+    vmstat.put("reclaimEfficiency", m_reclaimEfficiency);
+    vmstat.put("thrashingScore", m_thrashingScore);
+    vmstat.put("refaultRate", (int64_t)m_refaultRate);
+    vmstat.put("swapInRate", (int64_t)m_swapInRate);
+    vmstat.put("swapOutRate", (int64_t)m_swapOutRate);
+    vmstat.put("allocStallRate", (int64_t)m_allocStallRate);
+    json.put("vmstat", vmstat);
+}
+
+VmStatMonitor::VmStatMonitor(MemoryMonitor& monitor, GMainLoop* loop)
+    : m_updatedTime(0),
+      m_reclaimEfficiency(100),
+      m_thrashingScore(0),
+      m_refaultRate(0),
+      m_swapInRate(0),
+      m_swapOutRate(0),
+      m_allocStallRate(0),
+      m_memoryMonitor(monitor)
+{
+    memset(&m_vmStat, 0, sizeof(m_vmStat));
+
+    initSource(loop);
+}
+
+VmStatMonitor::~VmStatMonitor()
+{
+    deinitSource();
+}
+
+constexpr float SwapMonitor::DEFAULT_RATIO;
+
+void SwapMonitor::initSource(GMainLoop* loop)
+{
+    GMainContext* gCtxt = g_main_loop_get_context(loop);
+    gpointer gptr = (gpointer)this;
+
+    m_source = g_timeout_source_new(SettingManager::getSwapPeriod());
+    g_source_set_callback(m_source, MonitorEvent::onSourceCallback, gptr, NULL);
+    m_sourceId = g_source_attach(m_source, gCtxt);
+}
+
+void SwapMonitor::deinitSource()
+{
+    g_source_destroy(m_source);
+    g_source_unref(m_source);
+
+    for (Device& d : m_devices) {
+        if (d.fd >= 0)
+            close(d.fd);
+        d.fd = -1;
+    }
+}
+
+void SwapMonitor::update()
+{
+    bool wasFull = m_full;
+
+    sample();
+    if (m_full != wasFull)
+        this->m_memoryMonitor.raiseEvent((MonitorEvent&)*this);
+}
+
+void SwapMonitor::sample()
+{
+    MemInfoSnapshot mInfo;
+
+    if (!Proc::getMemInfo(mInfo))
+        return;
+
+    m_swapTotal = mInfo.swapTotal / 1024;
+    m_swapFree = mInfo.swapFree / 1024;
+
+    memset(&m_zram, 0, sizeof(m_zram));
+    for (Device& d : m_devices) {
+        ZramSnapshot s;
+        if (!Proc::getZramStat(d.path.c_str(), d.fd, s))
+            continue;
+
+        m_zram.origDataSize += s.origDataSize;
+        m_zram.comprDataSize += s.comprDataSize;
+        m_zram.memUsedTotal += s.memUsedTotal;
+        m_zram.memLimit += s.memLimit;
+        m_zram.samePages += s.samePages;
+        m_zram.hugePages += s.hugePages;
+    }
+
+    /* mem_used_total includes allocator overhead, so it is what RAM pays */
+    if (m_zram.memUsedTotal > 0)
+        m_ratio = (float)m_zram.origDataSize / m_zram.memUsedTotal;
+    else
+        m_ratio = DEFAULT_RATIO;
+
+    int fullRatio = SettingManager::getSwapFullRatio();
+    m_full = (m_swapTotal > 0 && (m_swapTotal - m_swapFree) * 100 >= m_swapTotal * fullRatio) ||
+             (m_zram.memLimit > 0 && m_zram.memUsedTotal * 100 >= m_zram.memLimit * fullRatio);
+
+    m_gain = 0;
+    if (isZram() && !m_full && m_ratio > 1.0f) {
+        /* Anon pages which can still go to zram, in KB of original size */
+        unsigned long room = min(mInfo.swapFree, mInfo.activeAnon + mInfo.inactiveAnon);
+        if (m_zram.memLimit > 0)
+            room = min(room, (unsigned long)((m_zram.memLimit - m_zram.memUsedTotal) / 1024 * m_ratio));
+
+        m_gain = (long)(room * (1.0f - 1.0f / m_ratio)) / 1024;
+    }
+}
+
+void SwapMonitor::print(JValue& json)
+{
+    JValue swap = pbnjson::Object();
+
+    swap.put("total", (int64_t)m_swapTotal);
+    swap.put("used", (int64_t)(m_swapTotal - m_swapFree));
+    swap.put("full", m_full);
+    swap.put("effectiveGain", (int64_t)m_gain);
+
+    if (isZram()) {
+        JValue zram = pbnjson::Object();
+        zram.put("origDataSize", (int64_t)(m_zram.origDataSize >> 20));
+        zram.put("comprDataSize", (int64_t)(m_zram.comprDataSize >> 20));
+        zram.put("memUsedTotal", (int64_t)(m_zram.memUsedTotal >> 20));
+        zram.put("memLimit", (int64_t)(m_zram.memLimit >> 20));
+        zram.put("samePages", (int64_t)m_zram.samePages);
+        zram.put("hugePages", (int64_t)m_zram.hugePages);
+        zram.put("ratio", m_ratio);
+        swap.put("zram", zram);
+    }
+
+    json.put("swap", swap);
+}
+
+SwapMonitor::SwapMonitor(MemoryMonitor& monitor, GMainLoop* loop)
+    : m_swapTotal(0),
+      m_swapFree(0),
+      m_ratio(DEFAULT_RATIO),
+      m_gain(0),
+      m_full(false),
+      m_memoryMonitor(monitor)
+{
+    vector<string> devices;
+
+    memset(&m_zram, 0, sizeof(m_zram));
+
+    Proc::getSwapDevices(devices);
+    for (const string& dev : devices) {
+        /* /dev/zram0 -> /sys/block/zram0/mm_stat */
+        string name = dev.substr(dev.rfind('/') + 1);
+        if (name.compare(0, 4, "zram") != 0)
+            continue;
+
+        Device d;
+        d.path = "/sys/block/" + name + "/mm_stat";
+        d.fd = -1;
+        m_devices.push_back(d);
+    }
+
+    /* Only seed state, MemoryManager is not ready for events yet */
+    sample();
+    initSource(loop);
+}
+
+SwapMonitor::~SwapMonitor()
+{
+    deinitSource();
+}
+
+void MemoryMonitor::print(JValue& json)
+{
+    for (MonitorEvent* e : m_eventList)
+        e->print(json);
+}
+
 void MemoryMonitor::raiseEvent(MonitorEvent& e)
 {
     MemoryManager *mm = MemoryManager::getInstance();
@@ -82,9 +650,39 @@ MemoryMonitor::MemoryMonitor()
 {
     setClassName("MemoryMonitor");
     MemoryManager *mm = MemoryManager::getInstance();
+    PsiMonitor *psi;
     MonitorEvent *e;
+    MemInfoSnapshot mInfo;
+
+    m_swapMonitor = nullptr;
 
     /* Create list of monitor event */
+    e = new VmStatMonitor(*this, mm->getMainLoop());
+    m_eventList.push_front(e);
+
+    if (Proc::getMemInfo(mInfo) && mInfo.swapTotal > 0) {
+        m_swapMonitor = new SwapMonitor(*this, mm->getMainLoop());
+        m_eventList.push_front(m_swapMonitor);
+        Logger::normal("SwapMonitor started, zram " + to_string(m_swapMonitor->isZram()),
+                       getClassName());
+    }
+
+    /* Sampler thread takes both meminfo polling and PSI triggers */
+    if (SettingManager::getSamplerThread()) {
+        e = new SamplerMonitor(*this, mm->getMainLoop(), mm->getMemoryHistory());
+        m_eventList.push_front(e);
+        Logger::normal("Sampler thread started", getClassName());
+        return;
+    }
+
+    psi = new PsiMonitor(*this, mm->getMainLoop());
+    if (psi->isAvailable()) {
+        m_eventList.push_front(psi);
+        Logger::normal("PSI trigger registered", getClassName());
+    } else {
+        delete psi;
+    }
+
     e = new AvailMemMonitor(*this, mm->getMainLoop());
     m_eventList.push_front(e);
 }
@@ -21,12 +21,21 @@
 #include <iostream>
 #include <fstream>
 #include <list>
+#include <vector>
+#include <pbnjson.hpp>
 
 #include "interface/IClassName.h"
+#include "memorymonitor/MemoryTrend.h"
+
+#include "util/Proc.h"
+#include "util/Cgroup.h"
+#include "util/CgroupTree.h"
 
 using namespace std;
+using namespace pbnjson;
 
 class MemoryMonitor;
+class Session;
 
 class MonitorEvent {
 public:
@@ -36,6 +45,7 @@ public:
     virtual void initSource(GMainLoop* loop) {};
     virtual void deinitSource() {};
     virtual void update() {};
+    virtual void print(JValue&) {};
 
     static gboolean onSourceCallback(gpointer eventInstance)
     {
@@ -55,17 +65,190 @@ public:
     virtual ~AvailMemMonitor();
 
     long getAvailable(void);
+    long getTotal() const { return m_total; }
+    long getSwapUsed() const { return m_swapUsed; }
+    int getUpdatePeriod() const { return m_updatePeriod; }
+    const MemoryTrend& getTrend() const { return m_trend; }
 
     // MonitorEvent
     virtual void initSource(GMainLoop* loop) override final;
     virtual void deinitSource() override final;
     virtual void update() override final;
 
+    static int nextUpdatePeriod(long available, long dropRate);
+
 private:
-    static const int m_updatePeriod = 1;
+    int m_updatePeriod;             // ms, adjusted on every update
+    MemoryTrend m_trend;
 
     unsigned long m_total;
     unsigned long m_available;
+    unsigned long m_swapUsed;
+    GMainLoop* m_loop;
+    MemoryMonitor& m_memoryMonitor;
+};
+
+class PsiMonitor : public MonitorEvent {
+public:
+    enum class Stall : char {
+        SOME = 0,
+        FULL,
+    };
+
+    explicit PsiMonitor(MemoryMonitor& monitor, GMainLoop* loop);
+    virtual ~PsiMonitor();
+
+    bool isAvailable() const;
+    enum Stall getStall() const { return m_stall; }
+    const PressureSnapshot& getPressure() const { return m_pressure; }
+
+    // MonitorEvent
+    virtual void initSource(GMainLoop* loop) override final;
+    virtual void deinitSource() override final;
+    virtual void update() override final;
+
+    static int openTrigger(const string& path, const char* type,
+                           int threshold, int window);
+
+    static const char* const PSI_MEMORY;
+
+private:
+    static gboolean onTrigger(gint fd, GIOCondition condition, gpointer data);
+
+    int m_fd[2];            // indexed by Stall
+    GSource* m_sources[2];  // indexed by Stall
+    enum Stall m_stall;
+    PressureSnapshot m_pressure;
+    MemoryMonitor& m_memoryMonitor;
+};
+
+class MemcgMonitor : public MonitorEvent {
+public:
+    explicit MemcgMonitor(MemoryMonitor& monitor, GMainLoop* loop,
+                          Session& session);
+    virtual ~MemcgMonitor();
+
+    Session& getSession() { return m_session; }
+    const MemcgEvents& getEvents() const { return m_events; }
+    const MemcgEvents& getDelta() const { return m_delta; }
+    bool isPressured() const { return m_pressured; }
+
+    // MonitorEvent
+    virtual void initSource(GMainLoop* loop) override final;
+    virtual void deinitSource() override final;
+    virtual void update() override final;
+
+private:
+    static gboolean onEvents(gint fd, GIOCondition condition, gpointer data);
+    static gboolean onPressure(gint fd, GIOCondition condition, gpointer data);
+
+    int m_inotifyFd;        // watches memory.events
+    int m_eventsFd;         // memory.events kept open for pread
+    int m_pressureFd;       // memory.pressure with "some" trigger
+    GSource* m_inotifySource;
+    GSource* m_pressureSource;
+
+    bool m_pressured;
+    MemcgEvents m_events;
+    MemcgEvents m_delta;
+    Session& m_session;
+    MemoryMonitor& m_memoryMonitor;
+};
+
+/* Keeps CgroupTree of a session and raises event when membership changes */
+class CgroupMonitor : public MonitorEvent {
+public:
+    explicit CgroupMonitor(MemoryMonitor& monitor, GMainLoop* loop,
+                           Session& session);
+    virtual ~CgroupMonitor();
+
+    Session& getSession() { return m_session; }
+    const CgroupTree& getTree() const { return m_tree; }
+
+    // MonitorEvent
+    virtual void initSource(GMainLoop* loop) override final;
+    virtual void deinitSource() override final;
+    virtual void update() override final;
+
+private:
+    static gboolean onEvents(gint fd, GIOCondition condition, gpointer data);
+
+    CgroupTree m_tree;
+    Session& m_session;
+    MemoryMonitor& m_memoryMonitor;
+};
+
+class VmStatMonitor : public MonitorEvent {
+public:
+    explicit VmStatMonitor(MemoryMonitor& monitor, GMainLoop* loop);
+    virtual ~VmStatMonitor();
+
+    int getReclaimEfficiency() const { return m_reclaimEfficiency; }
+    int getThrashingScore() const { return m_thrashingScore; }
+
+    // MonitorEvent
+    virtual void initSource(GMainLoop* loop) override final;
+    virtual void deinitSource() override final;
+    virtual void update() override final;
+    virtual void print(JValue& json) override final;
+
+private:
+    long long m_updatedTime;        // ms, monotonic
+    VmStatSnapshot m_vmStat;        // previous counters
+
+    /* Derived from deltas of last period */
+    int m_reclaimEfficiency;        // % of scanned pages which are reclaimed
+    int m_thrashingScore;           // % of reclaimed pages which are refaulted
+    long m_refaultRate;             // pages per second
+    long m_swapInRate;              // pages per second
+    long m_swapOutRate;             // pages per second
+    long m_allocStallRate;          // direct reclaim per second
+
+    MemoryMonitor& m_memoryMonitor;
+};
+
+/*
+ * Watches swap and zram devices. MemAvailable does not count anon pages
+ * which can still be compressed into zram, so it over-kills while zram has
+ * room. The gain is the RAM which is freed by compressing anon pages into
+ * remaining zram, and it becomes zero when zram is nearly full.
+ */
+class SwapMonitor : public MonitorEvent {
+public:
+    explicit SwapMonitor(MemoryMonitor& monitor, GMainLoop* loop);
+    virtual ~SwapMonitor();
+
+    bool isZram() const { return !m_devices.empty(); }
+    bool isFull() const { return m_full; }
+    float getRatio() const { return m_ratio; }
+    long getGain() const { return m_gain; }
+    long getEffectiveAvailable(long available) const { return available + m_gain; }
+
+    // MonitorEvent
+    virtual void initSource(GMainLoop* loop) override final;
+    virtual void deinitSource() override final;
+    virtual void update() override final;
+    virtual void print(JValue& json) override final;
+
+private:
+    /* Typical ratio of lzo/lz4, used until zram has data */
+    static constexpr float DEFAULT_RATIO = 2.0f;
+
+    void sample();
+
+    struct Device {
+        string path;            // mm_stat of the device
+        int fd;
+    };
+
+    vector<Device> m_devices;
+    ZramSnapshot m_zram;        // sum of all zram devices
+    long m_swapTotal;           // MB
+    long m_swapFree;            // MB
+    float m_ratio;              // original size / RAM used by zram
+    long m_gain;                // MB
+    bool m_full;
+
     MemoryMonitor& m_memoryMonitor;
 };
 
@@ -74,10 +257,15 @@ public:
     explicit MemoryMonitor();
     virtual ~MemoryMonitor();
 
+    /* nullptr if there is no swap */
+    SwapMonitor* getSwapMonitor() const { return m_swapMonitor; }
+
     void raiseEvent(MonitorEvent& event);
+    void print(JValue& json);
 
 private:
     list<MonitorEvent*> m_eventList;
+    SwapMonitor* m_swapMonitor;
 };
 
 #endif /* MEMORYMONITOR_MEMORYMONITOR_H_ */
@@ -0,0 +1,82 @@
+// Copyright (c) 2020 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "memorymonitor/MemoryTrend.h"
+
+void MemoryTrend::addSample(long long timeMs, long available)
+{
+    m_time[m_head] = timeMs;
+    m_available[m_head] = available;
+    m_head = (m_head + 1) % m_windowSize;
+    if (m_count < m_windowSize)
+        m_count++;
+
+    fit();
+}
+
+void MemoryTrend::reset()
+{
+    m_count = 0;
+    m_head = 0;
+    m_slope = 0;
+}
+
+void MemoryTrend::fit()
+{
+    long long latest = m_time[(m_head + m_windowSize - 1) % m_windowSize];
+    double sumT = 0, sumA = 0, sumTT = 0, sumTA = 0;
+    int n = 0;
+
+    for (int i = 0; i < m_count; ++i) {
+        if (latest - m_time[i] > m_maxAge)
+            continue;
+
+        /* Relative time in seconds to keep precision */
+        double t = (double)(m_time[i] - latest) / 1000;
+        double a = (double)m_available[i];
+
+        sumT += t;
+        sumA += a;
+        sumTT += t * t;
+        sumTA += t * a;
+        n++;
+    }
+
+    double denominator = n * sumTT - sumT * sumT;
+    if (n < 2 || denominator <= 0) {
+        m_slope = 0;
+        return;
+    }
+
+    m_slope = (n * sumTA - sumT * sumA) / denominator;
+}
+
+long MemoryTrend::getTimeToReach(long level) const
+{
+    if (m_count == 0 || m_slope >= 0)
+        return -1;
+
+    long latest = m_available[(m_head + m_windowSize - 1) % m_windowSize];
+    if (latest <= level)
+        return 0;
+
+    return (long)((latest - level) * 1000 / -m_slope);
+}
+
+MemoryTrend::MemoryTrend()
+{
+    reset();
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2020 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef MEMORYMONITOR_MEMORYTREND_H_
+#define MEMORYMONITOR_MEMORYTREND_H_
+
+/*
+ * Least-squares fit of available memory over the last few samples.
+ * Samples older than m_maxAge are not used for fitting.
+ */
+class MemoryTrend {
+public:
+    explicit MemoryTrend();
+    virtual ~MemoryTrend() {}
+
+    void addSample(long long timeMs, long available);
+    void reset();
+
+    /* MB per second, negative when available memory is falling */
+    double getSlope() const { return m_slope; }
+
+    /* Projected ms until available memory falls under <level>, -1 if never */
+    long getTimeToReach(long level) const;
+
+private:
+    static const int m_windowSize = 5;
+    static const long long m_maxAge = 10000;
+
+    void fit();
+
+    long long m_time[m_windowSize];
+    long m_available[m_windowSize];
+    int m_count;
+    int m_head;
+    double m_slope;
+};
+
+#endif /* MEMORYMONITOR_MEMORYTREND_H_ */
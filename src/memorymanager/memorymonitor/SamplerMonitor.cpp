@@ -0,0 +1,316 @@
+// Copyright (c) 2020 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "memorymonitor/SamplerMonitor.h"
+#include "memorymonitor/MemoryHistory.h"
+#include "setting/SettingManager.h"
+#include "base/MemoryLevel.h"
+
+#include "util/Logger.h"
+#include "util/Proc.h"
+#include "util/Time.h"
+
+#include <glib-unix.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+bool SamplerMonitor::setTimer(int periodMs)
+{
+    struct itimerspec spec;
+
+    spec.it_interval.tv_sec = periodMs / 1000;
+    spec.it_interval.tv_nsec = (long)(periodMs % 1000) * 1000000;
+    spec.it_value = spec.it_interval;
+
+    if (timerfd_settime(m_timerFd, 0, &spec, NULL) < 0)
+        return false;
+
+    m_updatePeriod = periodMs;
+    return true;
+}
+
+/* Called on sampler thread */
+bool SamplerMonitor::post(const SamplerEvent& event)
+{
+    unsigned head = m_queueHead.load(memory_order_relaxed);
+    uint64_t one = 1;
+
+    if (head - m_queueTail.load(memory_order_acquire) >= QUEUE_SIZE) {
+        m_dropped++;
+        return false;
+    }
+
+    m_queue[head % QUEUE_SIZE] = event;
+    m_queueHead.store(head + 1, memory_order_release);
+
+    if (write(m_notifyFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        return false;
+
+    return true;
+}
+
+/* Called on sampler thread */
+void SamplerMonitor::sample(int stall)
+{
+    MemInfoSnapshot mInfo;
+    PressureSnapshot pressure;
+    MemorySample sample;
+    SamplerEvent event;
+
+    if (!Proc::getMemInfo(mInfo))
+        return;
+
+    if (!Proc::getMemPressure(pressure))
+        pressure.someAvg10 = pressure.fullAvg10 = 0;
+
+    event.time = Time::getSystemTimeMs();
+    event.total = mInfo.memTotal / 1024;
+    event.available = mInfo.memAvailable / 1024;
+    event.stall = stall;
+
+    m_trend.addSample(event.time, event.available);
+    event.timeToCritical = m_trend.getTimeToReach(SettingManager::getMemoryLevelCriticalEnter());
+
+    int prev = m_level;
+    m_level = MemoryLevel::decide(m_level, event.available);
+    event.level = m_level;
+
+    /* Sampler thread is the only writer of history */
+    sample.time = event.time;
+    sample.total = event.total;
+    sample.available = event.available;
+    sample.swapUsed = (mInfo.swapTotal - mInfo.swapFree) / 1024;
+    sample.psiSomeAvg10 = pressure.someAvg10;
+    sample.psiFullAvg10 = pressure.fullAvg10;
+    snprintf(sample.level, sizeof(sample.level), "%s",
+             SettingManager::getMemoryLevel(m_level).name.c_str());
+    m_history.push(sample);
+
+    /*
+     * Nothing to do for main loop while normal level is kept. Other kept
+     * levels are posted once per action period, not on every sample.
+     */
+    long horizon = SettingManager::getPredictionHorizon();
+    bool predicted = (horizon > 0 && event.timeToCritical >= 0 &&
+                      event.timeToCritical <= horizon);
+    bool due = (m_level != 0 &&
+                event.time - m_postTime >= SettingManager::getSamplingActionPeriod());
+    if (prev != m_level || due || stall >= 0 || predicted) {
+        m_postTime = event.time;
+        post(event);
+    }
+
+    int period = AvailMemMonitor::nextUpdatePeriod(event.available, (long)-m_trend.getSlope());
+    if (period != m_updatePeriod)
+        setTimer(period);
+}
+
+void SamplerMonitor::run()
+{
+    struct epoll_event events[4];
+    int priority = SettingManager::getSamplerPriority();
+
+    if (priority > 0) {
+        struct sched_param param;
+        param.sched_priority = priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+            Logger::warning("Fail to set sampler priority " + to_string(priority), "SamplerMonitor");
+    }
+
+    while (true) {
+        int n = epoll_wait(m_epollFd, events, 4, -1);
+        int stall = -1;
+        bool woken = false;
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            Logger::error("epoll_wait failed: " + string(strerror(errno)), "SamplerMonitor");
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+
+            if (fd == m_stopFd)
+                return;
+
+            if (fd == m_timerFd) {
+                uint64_t expired;
+                if (read(m_timerFd, &expired, sizeof(expired)) < 0 && errno != EAGAIN)
+                    continue;
+                woken = true;
+                continue;
+            }
+
+            for (int s = 0; s < 2; ++s) {
+                if (fd != m_psiFd[s])
+                    continue;
+
+                if (events[i].events & EPOLLERR) {
+                    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, NULL);
+                    continue;
+                }
+                stall = max(stall, s);
+                woken = true;
+            }
+        }
+
+        if (woken)
+            sample(stall);
+    }
+}
+
+gboolean SamplerMonitor::onNotify(gint fd, GIOCondition, gpointer data)
+{
+    SamplerMonitor *p = static_cast<SamplerMonitor *>(data);
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        return G_SOURCE_CONTINUE;
+
+    p->update();
+    return G_SOURCE_CONTINUE;
+}
+
+void SamplerMonitor::initSource(GMainLoop* loop)
+{
+    GMainContext* gCtxt = g_main_loop_get_context(loop);
+    gpointer gptr = (gpointer)this;
+    struct epoll_event ev;
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    m_notifyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (m_epollFd < 0 || m_timerFd < 0 || m_notifyFd < 0 || m_stopFd < 0) {
+        Logger::error("Fail to create sampler fds: " + string(strerror(errno)), "SamplerMonitor");
+        return;
+    }
+
+    m_psiFd[(int)PsiMonitor::Stall::SOME] = PsiMonitor::openTrigger(PsiMonitor::PSI_MEMORY, "some",
+                                                SettingManager::getPsiSomeThreshold(),
+                                                SettingManager::getPsiWindow());
+    m_psiFd[(int)PsiMonitor::Stall::FULL] = PsiMonitor::openTrigger(PsiMonitor::PSI_MEMORY, "full",
+                                                SettingManager::getPsiFullThreshold(),
+                                                SettingManager::getPsiWindow());
+
+    ev.events = EPOLLIN;
+    ev.data.fd = m_stopFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_stopFd, &ev);
+
+    ev.events = EPOLLIN;
+    ev.data.fd = m_timerFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_timerFd, &ev);
+
+    for (int i = 0; i < 2; ++i) {
+        if (m_psiFd[i] < 0)
+            continue;
+        ev.events = EPOLLPRI;
+        ev.data.fd = m_psiFd[i];
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_psiFd[i], &ev);
+    }
+
+    m_source = g_unix_fd_source_new(m_notifyFd, G_IO_IN);
+    g_source_set_callback(m_source, (GSourceFunc)G_CALLBACK(SamplerMonitor::onNotify), gptr, NULL);
+    m_sourceId = g_source_attach(m_source, gCtxt);
+
+    setTimer(SettingManager::getSamplingMinPeriod());
+    m_thread = thread(&SamplerMonitor::run, this);
+}
+
+void SamplerMonitor::deinitSource()
+{
+    int* fds[] = { &m_epollFd, &m_timerFd, &m_notifyFd, &m_stopFd, &m_psiFd[0], &m_psiFd[1] };
+    uint64_t one = 1;
+
+    if (m_thread.joinable()) {
+        if (write(m_stopFd, &one, sizeof(one)) < 0)
+            Logger::error("Fail to stop sampler thread", "SamplerMonitor");
+        m_thread.join();
+    }
+
+    if (m_source) {
+        g_source_destroy(m_source);
+        g_source_unref(m_source);
+        m_source = nullptr;
+    }
+
+    for (int* fd : fds) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+/* Called on main loop. Take all posted events and handle the latest one */
+void SamplerMonitor::update()
+{
+    unsigned tail = m_queueTail.load(memory_order_relaxed);
+    unsigned head = m_queueHead.load(memory_order_acquire);
+    int stall = -1;
+
+    if (tail == head)
+        return;
+
+    for (; tail != head; ++tail) {
+        m_event = m_queue[tail % QUEUE_SIZE];
+        stall = max(stall, m_event.stall);
+    }
+    m_queueTail.store(tail, memory_order_release);
+
+    /* Keep the strongest PSI stall among coalesced events */
+    m_event.stall = stall;
+
+    this->m_memoryMonitor.raiseEvent((MonitorEvent&)*this);
+}
+
+SamplerMonitor::SamplerMonitor(MemoryMonitor& monitor, GMainLoop* loop,
+                               MemoryHistory& history)
+    : m_queueHead(0),
+      m_queueTail(0),
+      m_dropped(0),
+      m_epollFd(-1),
+      m_timerFd(-1),
+      m_notifyFd(-1),
+      m_stopFd(-1),
+      m_level(0),
+      m_updatePeriod(0),
+      m_postTime(0),
+      m_history(history),
+      m_memoryMonitor(monitor)
+{
+    m_psiFd[0] = m_psiFd[1] = -1;
+    m_source = nullptr;
+    memset(&m_event, 0, sizeof(m_event));
+
+    initSource(loop);
+}
+
+SamplerMonitor::~SamplerMonitor()
+{
+    deinitSource();
+}
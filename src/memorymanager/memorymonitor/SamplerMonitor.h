@@ -0,0 +1,95 @@
+// Copyright (c) 2020 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef MEMORYMONITOR_SAMPLERMONITOR_H_
+#define MEMORYMONITOR_SAMPLERMONITOR_H_
+
+#include <atomic>
+#include <thread>
+
+#include "memorymonitor/MemoryMonitor.h"
+#include "memorymonitor/MemoryTrend.h"
+
+using namespace std;
+
+class MemoryHistory;
+
+/* Sample which sampler thread decided to be handled by main loop */
+struct SamplerEvent {
+    long long time;         // ms, monotonic
+    long total;             // MB
+    long available;         // MB
+    long timeToCritical;    // ms, -1 if critical is not expected
+    int level;              // index of memory level tier
+    int stall;              // -1 if not woken by PSI, else PsiMonitor::Stall
+};
+
+/*
+ * Replacement of AvailMemMonitor and PsiMonitor which runs on its own thread.
+ * The thread waits on epoll for sampling timer and PSI triggers, decides
+ * memory level and records MemoryHistory. Only samples which need action
+ * are posted to main loop through lock-free queue, so that detection does
+ * not wait for main loop which may be blocked by Luna calls.
+ */
+class SamplerMonitor : public MonitorEvent {
+public:
+    explicit SamplerMonitor(MemoryMonitor& monitor, GMainLoop* loop,
+                            MemoryHistory& history);
+    virtual ~SamplerMonitor();
+
+    const SamplerEvent& getEvent() const { return m_event; }
+    unsigned long getDropped() const { return m_dropped.load(); }
+
+    // MonitorEvent
+    virtual void initSource(GMainLoop* loop) override final;
+    virtual void deinitSource() override final;
+    virtual void update() override final;
+
+private:
+    static const int QUEUE_SIZE = 64;
+
+    static gboolean onNotify(gint fd, GIOCondition condition, gpointer data);
+
+    void run();
+    void sample(int stall);
+    bool post(const SamplerEvent& event);
+    bool setTimer(int periodMs);
+
+    /* Single-producer single-consumer queue */
+    SamplerEvent m_queue[QUEUE_SIZE];
+    atomic<unsigned> m_queueHead;   // written by sampler thread
+    atomic<unsigned> m_queueTail;   // written by main loop
+    atomic<unsigned long> m_dropped;
+
+    int m_epollFd;
+    int m_timerFd;
+    int m_notifyFd;     // eventfd, sampler thread -> main loop
+    int m_stopFd;       // eventfd, main loop -> sampler thread
+    int m_psiFd[2];     // indexed by PsiMonitor::Stall
+
+    /* Owned by sampler thread */
+    int m_level;
+    int m_updatePeriod;
+    long long m_postTime;   // ms monotonic when last event is posted
+    MemoryTrend m_trend;
+
+    SamplerEvent m_event;   // latest event taken by main loop
+    thread m_thread;
+    MemoryHistory& m_history;
+    MemoryMonitor& m_memoryMonitor;
+};
+
+#endif /* MEMORYMONITOR_SAMPLERMONITOR_H_ */
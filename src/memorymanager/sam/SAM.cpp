@@ -19,14 +19,25 @@
 
 #include "util/JValueUtil.h"
 #include "util/Logger.h"
+#include "util/Time.h"
 
 #include <glib.h>
 
 const string SAM::m_externalServiceName = "com.webos.service.applicationmanager";
 const int SAM::m_closeTimeOutMs = 5000;
 
-bool SAM::close(string appId, string instanceId)
+/*
+ * Ask SAM to close an app without waiting for the reply. <callback> gets
+ * the result and measured latency on the main loop, or false after
+ * m_closeTimeOutMs. A close of the same app already in flight is not sent
+ * again and <callback> is not called for it.
+ */
+CloseResult SAM::close(const string& appId, const string& instanceId, CloseCallback callback)
 {
+    const string key = Runtime::makeAppKey(appId, instanceId);
+    if (m_pendingCloses.find(key) != m_pendingCloses.end())
+        return CloseResult::PENDING;
+
     JValue payload = pbnjson::Object();
     payload.put("instanceId", instanceId);
     payload.put("id", appId);
@@ -35,44 +46,122 @@ bool SAM::close(string appId, string instanceId)
     LS::Handle *handle = LunaConnector::getInstance()->getHandle();
     const string uri = "luna://com.webos.service.applicationmanager/close";
 
-    Call call;
+    PendingClose* pending = new PendingClose();
+    pending->sam = this;
+    pending->key = key;
+    pending->appId = appId;
+    pending->callback = callback;
+    pending->begin = Time::getSystemTimeMs();
+
+    try {
 #if defined(ENABLE_SESSION)
-    if (m_session.getSessionId().empty()) {
-        call = handle->callOneReply(uri.c_str(), payload.stringify().c_str(),
-                                    (const char *)nullptr, (const char *)nullptr);
-    } else {
-        call = handle->callOneReply(uri.c_str(), payload.stringify().c_str(),
-                                    (const char *)nullptr, m_session.getSessionId().c_str());
-    }
+        if (m_session.getSessionId().empty()) {
+            pending->call = handle->callOneReply(uri.c_str(), payload.stringify().c_str(),
+                                                 (const char *)nullptr, (const char *)nullptr);
+        } else {
+            pending->call = handle->callOneReply(uri.c_str(), payload.stringify().c_str(),
+                                                 (const char *)nullptr,
+                                                 m_session.getSessionId().c_str());
+        }
 #else
-    call = handle->callOneReply(uri.c_str(), payload.stringify().c_str(),
-                                (const char *)nullptr);
+        pending->call = handle->callOneReply(uri.c_str(), payload.stringify().c_str(),
+                                             (const char *)nullptr);
 #endif
-
-    Message response = call.get(m_closeTimeOutMs);
-    if (!response) {
-        Logger::error("Error: No response from SAM in 5s", getClassName());
-        return false;
+        pending->call.continueWith(onClose, pending);
+    } catch (const LS::Error& e) {
+        Logger::error("Error: " + string(e.what()), getClassName());
+        delete pending;
+        return CloseResult::FAILED;
     }
 
+    pending->timeoutId = g_timeout_add(m_closeTimeOutMs, onCloseTimeout, pending);
+    m_pendingCloses[key] = pending;
+    return CloseResult::SENT;
+}
+
+bool SAM::isClosing(const string& appId, const string& instanceId) const
+{
+    return m_pendingCloses.find(Runtime::makeAppKey(appId, instanceId)) != m_pendingCloses.end();
+}
+
+bool SAM::onClose(LSHandle *, LSMessage *msg, void *ctxt)
+{
+    PendingClose* pending = static_cast<PendingClose*>(ctxt);
+    SAM* p = pending->sam;
+    Message response(msg);
+
     if (response.isHubError()) {
-        Logger::error("Error: " + string(response.getPayload()), getClassName());
-        return false;
+        Logger::error("Error: " + string(response.getPayload()), p->getClassName());
+        p->finishClose(pending, false);
+        return true;
     }
 
     JValue responsePayload = JDomParser::fromString(response.getPayload());
     bool returnValue = false;
 
     JValueUtil::getValue(responsePayload, "returnValue", returnValue);
-    if (returnValue != true) {
-        Logger::error("Error: " + string(response.getPayload()), getClassName());
-        return false;
-    }
+    if (returnValue != true)
+        Logger::error("Error: " + string(response.getPayload()), p->getClassName());
 
-    /* Successful response from SAM */
+    p->finishClose(pending, returnValue);
     return true;
 }
 
+gboolean SAM::onCloseTimeout(gpointer ctxt)
+{
+    PendingClose* pending = static_cast<PendingClose*>(ctxt);
+
+    Logger::error("Error: No response from SAM in " + to_string(m_closeTimeOutMs) + "ms",
+                  pending->sam->getClassName());
+    pending->timeoutId = 0;
+    pending->call.cancel();
+    pending->sam->finishClose(pending, false);
+    return G_SOURCE_REMOVE;
+}
+
+/* LS::Call can't be destroyed in its own reply callback */
+gboolean SAM::onCloseDone(gpointer ctxt)
+{
+    delete static_cast<PendingClose*>(ctxt);
+    return G_SOURCE_REMOVE;
+}
+
+void SAM::finishClose(PendingClose* pending, bool success)
+{
+    long long latency = Time::getSystemTimeMs() - pending->begin;
+
+    if (pending->timeoutId)
+        g_source_remove(pending->timeoutId);
+    pending->timeoutId = 0;
+    m_pendingCloses.erase(pending->key);
+
+    m_closeCount++;
+    if (!success)
+        m_closeFailCount++;
+    m_closeLatencySum += latency;
+    m_closeLatencyMax = max(m_closeLatencyMax, latency);
+
+    Logger::normal("Close " + pending->appId + (success ? " done" : " failed") +
+                   " in " + to_string(latency) + " ms", getClassName());
+
+    if (pending->callback)
+        pending->callback(success, latency);
+
+    g_idle_add(onCloseDone, pending);
+}
+
+void SAM::print(JValue& json)
+{
+    JValue close = pbnjson::Object();
+
+    close.put("count", (int64_t)m_closeCount);
+    close.put("failed", (int64_t)m_closeFailCount);
+    close.put("pending", (int)m_pendingCloses.size());
+    close.put("avgLatency", (int64_t)(m_closeCount ? m_closeLatencySum / m_closeCount : 0));
+    close.put("maxLatency", (int64_t)m_closeLatencyMax);
+    json.put("close", close);
+}
+
 bool SAM::onGetAppLifeEvents(LSHandle *sh, LSMessage *msg, void *ctxt)
 {
     SAM* p = static_cast<SAM*>(ctxt);
@@ -98,18 +187,14 @@ bool SAM::onGetAppLifeEvents(LSHandle *sh, LSMessage *msg, void *ctxt)
             return true;
 
     /* If the app is not in runtime, search apps in list which wait to run */
-    auto it = p->m_appsWaitToRun.begin();
-    for (; it != p->m_appsWaitToRun.end(); ++it) {
-        if (it->getAppId() == appId && it->getInstanceId() == instanceId)
-            break;
-    }
+    const string key = Runtime::makeAppKey(appId, instanceId);
+    auto it = p->m_appsWaitToRun.find(key);
 
     if (it == p->m_appsWaitToRun.end()) {
-        Application* app = new Application(instanceId, appId, "", event, -1);
-        p->m_appsWaitToRun.push_back(*app);
-        delete app;
+        Application app(instanceId, appId, "", event, -1);
+        p->m_appsWaitToRun.insert(make_pair(key, app));
     } else {
-        it->setStatus(event);
+        it->second.setStatus(event);
     }
 
     return true;
@@ -149,20 +234,21 @@ bool SAM::onRunning(LSHandle *sh, LSMessage *msg, void *ctxt)
         p->m_session.m_runtime->addReservedPid(stoi(pid));
 
         /* Move complete app instance to Runtime */
-        auto it = p->m_appsWaitToRun.begin();
-        for (; it != p->m_appsWaitToRun.end(); ++it) {
-            if (it->getAppId() == appId && it->getInstanceId() == instanceId)
-                break;
-        }
-
+        auto it = p->m_appsWaitToRun.find(Runtime::makeAppKey(appId, instanceId));
         if (it == p->m_appsWaitToRun.end())
             continue;
 
-        it->setPid(stoi(pid));
-        it->setType(appType);
-        p->m_session.m_runtime->addApp(*it);
+        it->second.setPid(stoi(pid));
+        it->second.setType(appType);
+        p->m_session.m_runtime->addApp(it->second);
         p->m_session.m_runtime->printApp();
         p->m_appsWaitToRun.erase(it);
+
+        /*
+         * App is not at its footprint yet, but from now on its growth is
+         * handled by memory levels like any running app
+         */
+        MemoryManager::getInstance()->releaseReservation(appId);
     }
 
     return true;
@@ -219,9 +305,8 @@ void SAM::initAppWaitToRun()
         /* To remove duplicated pid from Service list later */
         m_session.m_runtime->addReservedPid(stoi(pid));
 
-        Application *app = new Application(instanceId, appId, appType, "", stoi(pid));
-        m_appsWaitToRun.push_back(*app);
-        delete app;
+        Application app(instanceId, appId, appType, "", stoi(pid));
+        m_appsWaitToRun.insert(make_pair(Runtime::makeAppKey(appId, instanceId), app));
     }
     return;
 }
@@ -292,12 +377,23 @@ void SAM::onDisconnected()
 
 SAM::SAM(Session& session)
     : LunaSubscriber(SAM::m_externalServiceName, session.getSessionId()),
-      m_session(session)
+      m_session(session),
+      m_closeCount(0),
+      m_closeFailCount(0),
+      m_closeLatencySum(0),
+      m_closeLatencyMax(0)
 {
     setClassName("SAM");
 }
 
 SAM::~SAM()
 {
-
+    /* Callbacks may refer to the session which is going away */
+    for (auto it = m_pendingCloses.begin(); it != m_pendingCloses.end(); ++it) {
+        if (it->second->timeoutId)
+            g_source_remove(it->second->timeoutId);
+        it->second->call.cancel();
+        delete it->second;
+    }
+    m_pendingCloses.clear();
 }
@@ -17,7 +17,8 @@
 #ifndef SAM_SAM_H_
 #define SAM_SAM_H_
 
-#include <list>
+#include <functional>
+#include <unordered_map>
 
 #include "luna2/LunaConnector.h"
 #include "session/Session.h"
@@ -25,13 +26,26 @@
 
 #include "interface/IClassName.h"
 
+/* Called on the main loop when SAM replies or close times out */
+typedef function<void(bool success, long long latencyMs)> CloseCallback;
+
+/* Result of SAM::close() */
+enum class CloseResult : char {
+    FAILED = 0, // request can't be sent
+    SENT,
+    PENDING,    // close of the same app is already in flight
+};
+
 class SAM : public IClassName,
             public LunaSubscriber {
 public:
     explicit SAM(Session &session);
     virtual ~SAM();
 
-    bool close(string appId, string instanceId);
+    CloseResult close(const string& appId, const string& instanceId,
+                      CloseCallback callback = nullptr);
+    bool isClosing(const string& appId, const string& instanceId) const;
+    void print(JValue& json);
 
     // LunaSuscriber
     virtual void onDisconnected() override final;
@@ -40,6 +54,21 @@ public:
 private:
     static bool onGetAppLifeEvents(LSHandle *sh, LSMessage *msg, void *ctxt);
     static bool onRunning(LSHandle *sh, LSMessage *msg, void *ctxt);
+    static bool onClose(LSHandle *sh, LSMessage *msg, void *ctxt);
+    static gboolean onCloseTimeout(gpointer ctxt);
+    static gboolean onCloseDone(gpointer ctxt);
+
+    /* Close request in flight, kept on heap as LS::Call refers itself */
+    struct PendingClose {
+        SAM* sam;
+        string key;
+        string appId;
+        CloseCallback callback;
+        Call call;
+        long long begin;
+        guint timeoutId;
+    };
+    void finishClose(PendingClose* pending, bool success);
 
     static const string m_externalServiceName;
     static const int m_closeTimeOutMs;
@@ -47,8 +76,16 @@ private:
     void initAppWaitToRun();
     void initDefaultStatus();
 
-    list<Application> m_appsWaitToRun;
+    /* Apps which wait for pid, by Runtime::makeAppKey() */
+    unordered_map<string, Application> m_appsWaitToRun;
     Session& m_session;
+
+    /* Closes in flight, by Runtime::makeAppKey() */
+    unordered_map<string, PendingClose*> m_pendingCloses;
+    unsigned long m_closeCount;
+    unsigned long m_closeFailCount;
+    long long m_closeLatencySum;
+    long long m_closeLatencyMax;
 };
 
 #endif /* SAM_SAM_H_ */
@@ -36,7 +36,9 @@ Session::Session(const string& sessionId,
       m_accountId(accountId),
       m_uid(uid),
       m_sam(nullptr),
-      m_runtime(nullptr)
+      m_runtime(nullptr),
+      m_memcgMonitor(nullptr),
+      m_cgroupMonitor(nullptr)
 {
     setClassName("Session");
 
@@ -45,10 +47,21 @@ Session::Session(const string& sessionId,
 
     m_sam = new SAM(*this);
     m_runtime = new Runtime(*this);
+
+    MemoryManager* mm = MemoryManager::getInstance();
+    m_memcgMonitor = new MemcgMonitor(mm->getMemoryMonitor(), mm->getMainLoop(), *this);
+    m_cgroupMonitor = new CgroupMonitor(mm->getMemoryMonitor(), mm->getMainLoop(), *this);
+    m_runtime->syncService();
 }
 
 Session::~Session()
 {
+    if (m_memcgMonitor)
+        delete m_memcgMonitor;
+
+    if (m_cgroupMonitor)
+        delete m_cgroupMonitor;
+
     if (m_sam)
         delete m_sam;
 
@@ -75,6 +88,25 @@ void Session::print(JValue& json)
     json.put("accountId", m_accountId);
     json.put("uid", m_uid);
     json.put("path", m_path);
+
+    /* Charged to the session memcg, including kernel memory. In KB */
+    MemcgUsage usage;
+    if (Cgroup::getMemoryUsage(m_path, usage)) {
+        JValue memory = pbnjson::Object();
+        memory.put("current", (int64_t)(usage.current / 1024));
+        memory.put("swap", (int64_t)(usage.swapCurrent / 1024));
+        memory.put("anon", (int64_t)(usage.anon / 1024));
+        memory.put("file", (int64_t)(usage.file / 1024));
+        memory.put("shmem", (int64_t)(usage.shmem / 1024));
+        memory.put("slab", (int64_t)(usage.slab / 1024));
+        memory.put("kernelStack", (int64_t)(usage.kernelStack / 1024));
+        memory.put("pageTables", (int64_t)(usage.pageTables / 1024));
+        memory.put("sock", (int64_t)(usage.sock / 1024));
+        json.put("memory", memory);
+    }
+
+    if (m_sam)
+        m_sam->print(json);
 }
 
 bool SessionMonitor::onGetSessions(LSHandle *sh, LSMessage *msg, void *ctxt)
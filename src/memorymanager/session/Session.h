@@ -29,6 +29,8 @@ using namespace std;
 
 class SAM;
 class Runtime;
+class MemcgMonitor;
+class CgroupMonitor;
 
 class Session : public IPrintable,
                 public IClassName {
@@ -48,6 +50,8 @@ public:
 
     Runtime* m_runtime;
     SAM* m_sam;
+    MemcgMonitor* m_memcgMonitor;
+    CgroupMonitor* m_cgroupMonitor;
 
 private:
     const string m_sessionId; /* unique id which external SessionManager creates for each session */
@@ -62,7 +66,7 @@ public:
     explicit SessionMonitor();
     virtual ~SessionMonitor();
 
-    std::map<string, Session*> getSessions() { return m_sessions; }
+    const std::map<string, Session*>& getSessions() const { return m_sessions; }
 
     // LunaSuscriber
     virtual void onDisconnected() override final;
@@ -16,8 +16,11 @@
 
 #include "SettingManager.h"
 #include "util/Logger.h"
+#include "util/JValueUtil.h"
+#include "util/Proc.h"
 
 #include <glib.h>
+#include <math.h>
 #include <strings.h>
 #include <unistd.h>
 #include <pbnjson.h>
@@ -27,11 +30,74 @@
 bool SettingManager::m_SingleAppPolicy;
 bool SettingManager::m_SessionEnabled;
 
+MemoryLevelSetting SettingManager::m_memoryLevels[MAX_MEMORY_LEVELS];
+int SettingManager::m_memoryLevelCount;
+string SettingManager::m_memoryLevelSource;
+int SettingManager::m_memTotal;
+
 int SettingManager::m_memoryLevelLowEnter;
 int SettingManager::m_memoryLevelLowExit;
 int SettingManager::m_memoryLevelCriticalEnter;
 int SettingManager::m_memoryLevelCriticalExit;
 
+int SettingManager::m_psiSomeThreshold;
+int SettingManager::m_psiFullThreshold;
+int SettingManager::m_psiWindow;
+
+int SettingManager::m_samplingMinPeriod;
+int SettingManager::m_samplingMaxPeriod;
+int SettingManager::m_samplingBand;
+int SettingManager::m_samplingActionPeriod;
+
+int SettingManager::m_predictionHorizon;
+
+bool SettingManager::m_samplerThread;
+int SettingManager::m_samplerPriority;
+
+int SettingManager::m_vmStatPeriod;
+int SettingManager::m_vmStatRefaultFloor;
+int SettingManager::m_thrashingLow;
+int SettingManager::m_thrashingCritical;
+
+int SettingManager::m_pssWorkers;
+int SettingManager::m_pssTopN;
+int SettingManager::m_pssRssDelta;
+int SettingManager::m_pssPeriod;
+
+int SettingManager::m_swapPeriod;
+int SettingManager::m_swapFullRatio;
+bool SettingManager::m_swapEffective;
+
+int SettingManager::m_victimWeightAge;
+int SettingManager::m_victimWeightSize;
+int SettingManager::m_victimWeightSwap;
+int SettingManager::m_victimWeightOom;
+int SettingManager::m_victimWeightWeb;
+int SettingManager::m_victimMaxCount;
+set<string> SettingManager::m_protectedApps;
+
+int SettingManager::m_plannerSettle;
+
+bool SettingManager::m_reclaimEnable;
+int SettingManager::m_reclaimSwappiness;
+int SettingManager::m_reclaimChunk;
+
+bool SettingManager::m_freezeEnable;
+int SettingManager::m_freezeIdle;
+
+bool SettingManager::m_pageoutEnable;
+int SettingManager::m_pageoutCold;
+int SettingManager::m_pageoutIdle;
+
+int SettingManager::m_admissionLease;
+
+string SettingManager::m_profilePath;
+int SettingManager::m_profileWindow;
+int SettingManager::m_profileRecords;
+
+const string SettingManager::CONFIG_FILE = "memorymanager.json";
+const int SettingManager::REFERENCE_MEM_TOTAL = 2048;
+
 void SettingManager::initEnv()
 {
     char* ls2EnableSession = getenv("LS2_ENABLE_SESSION");
@@ -43,10 +109,383 @@ void SettingManager::initEnv()
 
     m_SingleAppPolicy = false;
 
-    m_memoryLevelLowEnter = 350;
-    m_memoryLevelLowExit = 380;
-    m_memoryLevelCriticalEnter = 200;
-    m_memoryLevelCriticalExit = 230;
+    setDefaultMemoryLevels();
+    deriveMemoryLevels();
+
+    m_psiSomeThreshold = 150000;
+    m_psiFullThreshold = 50000;
+    m_psiWindow = 1000000;
+
+    m_samplingMinPeriod = 200;
+    m_samplingMaxPeriod = 5000;
+    m_samplingBand = 400;
+    m_samplingActionPeriod = 1000;
+
+    m_predictionHorizon = 3000;
+
+    m_samplerThread = false;
+    m_samplerPriority = 1;
+
+    m_vmStatPeriod = 2000;
+    m_vmStatRefaultFloor = 256;
+    m_thrashingLow = 50;
+    m_thrashingCritical = 90;
+
+    m_pssWorkers = 4;
+    m_pssTopN = 5;
+    m_pssRssDelta = 4096;
+    m_pssPeriod = 2000;
+
+    m_swapPeriod = 2000;
+    m_swapFullRatio = 90;
+    m_swapEffective = true;
+
+    m_victimWeightAge = 40;
+    m_victimWeightSize = 40;
+    m_victimWeightSwap = 5;
+    m_victimWeightOom = 10;
+    m_victimWeightWeb = 5;
+    m_victimMaxCount = 3;
+    m_protectedApps.clear();
+
+    m_plannerSettle = 1000;
+
+    m_reclaimEnable = true;
+    m_reclaimSwappiness = 100;
+    m_reclaimChunk = 16384;
+
+    m_freezeEnable = true;
+    m_freezeIdle = 60000;
+
+    m_pageoutEnable = true;
+    m_pageoutCold = 30000;
+    m_pageoutIdle = 60000;
+
+    m_admissionLease = 10000;
+
+    m_profilePath = string(WEBOS_INSTALL_LOCALSTATEDIR) + "/lib/memorymanager/launchprofile";
+    m_profileWindow = 10000;
+    m_profileRecords = 256;
+}
+
+/* Fixed tiers, used as they are when levels are not derived */
+void SettingManager::setDefaultMemoryLevels()
+{
+    m_memoryLevels[0] = { "normal", 0, 0, 0, "none" };
+    m_memoryLevels[1] = { "low", 350, 380, 0, "low" };
+    m_memoryLevels[2] = { "critical", 200, 230, 0, "critical" };
+    m_memoryLevelCount = 3;
+    m_memoryLevelSource = "default";
+    updateMemoryLevels();
+}
+
+/*
+ * Derive default tiers from RAM size, zram and kernel watermarks, so that
+ * one image fits boards of any size. Margins of the fixed tiers are scaled
+ * by sqrt(MemTotal / REFERENCE_MEM_TOTAL), which makes them a larger share
+ * of small boards and a smaller share of large ones.
+ *  - critical is kept above high watermarks of all zones, which kernel
+ *    holds back for its own reclaim. They are derived from min_free_kbytes,
+ *    which is only used when /proc/zoneinfo can't be read
+ *  - exit is above enter by the gap kswapd reclaims in one go at least
+ *  - low leaves room for zram to grow, assuming 3:1 compression
+ */
+void SettingManager::deriveMemoryLevels()
+{
+    MemInfoSnapshot memInfo;
+    WatermarkSnapshot watermark;
+    unsigned long minFreeKb = 0;
+    unsigned long zramKb = 0;
+
+    if (!Proc::getMemInfo(memInfo)) {
+        Logger::warning("Failed to read MemTotal, use default levels", "SettingManager");
+        return;
+    }
+    m_memTotal = memInfo.memTotal / 1024;
+
+    /* Kernel sets low and high 1/4 and 1/2 of min above min by default */
+    if (!Proc::getWatermarks(watermark) && Proc::getMinFreeKbytes(minFreeKb)) {
+        watermark.minKb = minFreeKb;
+        watermark.lowKb = minFreeKb * 5 / 4;
+        watermark.highKb = minFreeKb * 3 / 2;
+    }
+    Proc::getZramDiskSize(zramKb);
+
+    double scale = sqrt((double)m_memTotal / REFERENCE_MEM_TOTAL);
+    scale = fmin(fmax(scale, 0.5), 2.0);
+
+    int reserve = (int)(watermark.highKb / 1024);
+    int gap = (int)((watermark.highKb - watermark.lowKb) / 1024);
+    int margin = max((int)(30 * scale), gap);
+
+    int criticalEnter = max((int)(200 * scale), reserve);
+    int criticalExit = criticalEnter + margin;
+    int lowEnter = criticalExit + (int)(120 * scale) + (int)(zramKb / 1024 / 3 / 8);
+    int lowExit = lowEnter + margin;
+
+    /* Boards too small for a model, keep the table they are tuned with */
+    if (lowExit >= m_memTotal / 2) {
+        Logger::warning("Derived levels exceed half of " + to_string(m_memTotal) +
+                        " MB, use default levels", "SettingManager");
+        return;
+    }
+
+    m_memoryLevels[1] = { "low", lowEnter, lowExit, 0, "low" };
+    m_memoryLevels[2] = { "critical", criticalEnter, criticalExit, 0, "critical" };
+    m_memoryLevelCount = 3;
+    m_memoryLevelSource = "derived";
+    updateMemoryLevels();
+
+    Logger::normal("Levels derived from " + to_string(m_memTotal) + " MB" +
+                   " (zram " + to_string(zramKb / 1024) + " MB, high watermark " +
+                   to_string(watermark.highKb / 1024) + " MB): low " +
+                   to_string(lowEnter) + "/" + to_string(lowExit) + ", critical " +
+                   to_string(criticalEnter) + "/" + to_string(criticalExit),
+                   "SettingManager");
+}
+
+/* Thresholds of the first "low" and "critical" tiers */
+void SettingManager::updateMemoryLevels()
+{
+    int low = -1, critical = -1;
+
+    for (int i = 1; i < m_memoryLevelCount; ++i) {
+        if (low < 0 && m_memoryLevels[i].action == "low")
+            low = i;
+        if (critical < 0 && m_memoryLevels[i].action == "critical")
+            critical = i;
+    }
+
+    if (low < 0)
+        low = 1;
+    if (critical < 0)
+        critical = m_memoryLevelCount - 1;
+
+    m_memoryLevelLowEnter = m_memoryLevels[low].enter;
+    m_memoryLevelLowExit = m_memoryLevels[low].exit;
+    m_memoryLevelCriticalEnter = m_memoryLevels[critical].enter;
+    m_memoryLevelCriticalExit = m_memoryLevels[critical].exit;
+}
+
+/* Replace tiers only if all of them are valid, keep defaults otherwise */
+bool SettingManager::loadMemoryLevels(JValue& levels)
+{
+    MemoryLevelSetting tiers[MAX_MEMORY_LEVELS];
+    int count = 0;
+
+    if (!levels.isArray() || levels.arraySize() < 2 ||
+        levels.arraySize() > MAX_MEMORY_LEVELS) {
+        Logger::error("Invalid number of levels, use default", "SettingManager");
+        return false;
+    }
+
+    for (JValue level : levels.items()) {
+        MemoryLevelSetting& tier = tiers[count];
+
+        tier.name = "";
+        tier.enter = tier.exit = tier.dwell = 0;
+        tier.action = "none";
+        JValueUtil::getValue(level, "name", tier.name);
+        JValueUtil::getValue(level, "enter", tier.enter);
+        JValueUtil::getValue(level, "exit", tier.exit);
+        JValueUtil::getValue(level, "dwell", tier.dwell);
+        JValueUtil::getValue(level, "action", tier.action);
+
+        bool valid = !tier.name.empty() &&
+                     (tier.action == "none" || tier.action == "reclaim" ||
+                      tier.action == "low" || tier.action == "critical");
+        if (count > 0)
+            valid = valid && tier.enter < tier.exit &&
+                    (count == 1 || tier.enter < tiers[count - 1].enter);
+        if (!valid) {
+            Logger::error("Invalid level " + to_string(count) + ", use default",
+                          "SettingManager");
+            return false;
+        }
+        count++;
+    }
+
+    for (int i = 0; i < count; ++i)
+        m_memoryLevels[i] = tiers[i];
+    m_memoryLevelCount = count;
+    m_memoryLevelSource = "config";
+    updateMemoryLevels();
+    return true;
+}
+
+/*
+ * Take levels of the first override which matches this board. "model" is
+ * a part of device tree model and "maxTotal" is MB of RAM at most. All
+ * given conditions should match.
+ */
+void SettingManager::loadMemoryLevelOverrides(JValue& overrides)
+{
+    string model;
+
+    if (!overrides.isArray())
+        return;
+
+    Proc::getDeviceModel(model);
+    for (JValue entry : overrides.items()) {
+        string match;
+        int maxTotal = 0;
+        JValue levels;
+
+        bool hasModel = JValueUtil::getValue(entry, "model", match);
+        bool hasTotal = JValueUtil::getValue(entry, "maxTotal", maxTotal);
+        if (!hasModel && !hasTotal)
+            continue;
+        if (hasModel && (match.empty() || model.find(match) == string::npos))
+            continue;
+        if (hasTotal && (m_memTotal == 0 || m_memTotal > maxTotal))
+            continue;
+        if (!JValueUtil::getValue(entry, "levels", levels))
+            continue;
+
+        if (loadMemoryLevels(levels)) {
+            m_memoryLevelSource = "override";
+            Logger::normal("Levels overridden for '" + model + "' " +
+                           to_string(m_memTotal) + " MB", "SettingManager");
+        }
+        return;
+    }
+}
+
+/*
+ * Override default values with optional configuration file. Levels are
+ * derived from the board unless "autoLevels" is false, then replaced by
+ * "levels" and by the first matching entry of "overrides" in turn.
+ * {
+ *     "autoLevels" : true,
+ *     "levels" : [ { "name" : "normal", "action" : "none" },
+ *                  { "name" : "low", "enter" : 350, "exit" : 380,
+ *                    "dwell" : 0, "action" : "low" },
+ *                  { "name" : "critical", "enter" : 200, "exit" : 230,
+ *                    "dwell" : 0, "action" : "critical" } ],
+ *     "overrides" : [ { "model" : "<device tree model>", "maxTotal" : 1536,
+ *                       "levels" : [ ... ] }, ... ],
+ *     "psi" : { "someThreshold" : 150000, "fullThreshold" : 50000,
+ *               "window" : 1000000 },
+ *     "sampling" : { "minPeriod" : 200, "maxPeriod" : 5000, "band" : 400,
+ *                    "actionPeriod" : 1000 },
+ *     "prediction" : { "horizon" : 3000 },
+ *     "sampler" : { "thread" : false, "priority" : 1 },
+ *     "vmstat" : { "period" : 2000, "refaultFloor" : 256,
+ *                  "thrashingLow" : 50, "thrashingCritical" : 90 },
+ *     "pss" : { "workers" : 4, "topN" : 5,
+ *               "rssDelta" : 4096, "period" : 2000 },
+ *     "swap" : { "period" : 2000, "fullRatio" : 90, "effective" : true },
+ *     "victim" : { "age" : 40, "size" : 40, "swap" : 5, "oom" : 10, "web" : 5,
+ *                  "maxCount" : 3, "protected" : [ "<appId>", ... ] },
+ *     "planner" : { "settle" : 1000 },
+ *     "reclaim" : { "enable" : true, "swappiness" : 100, "chunk" : 16384 },
+ *     "freeze" : { "enable" : true, "idle" : 60000 },
+ *     "pageout" : { "enable" : true, "cold" : 30000, "idle" : 60000 },
+ *     "admission" : { "lease" : 10000 },
+ *     "profile" : { "path" : "<file>", "window" : 10000, "records" : 256 }
+ * }
+ */
+void SettingManager::loadConfig()
+{
+    const string path = string(WEBOS_INSTALL_WEBOS_SYSCONFDIR) + "/" + CONFIG_FILE;
+
+    if (access(path.c_str(), R_OK) != 0)
+        return;
+
+    JValue config = JDomParser::fromFile(path.c_str());
+    if (!config.isObject()) {
+        Logger::error("Invalid configuration file: " + path, "SettingManager");
+        return;
+    }
+
+    bool autoLevels = true;
+    JValueUtil::getValue(config, "autoLevels", autoLevels);
+    if (!autoLevels)
+        setDefaultMemoryLevels();
+
+    JValue levels;
+    if (JValueUtil::getValue(config, "levels", levels))
+        loadMemoryLevels(levels);
+
+    JValue overrides;
+    if (JValueUtil::getValue(config, "overrides", overrides))
+        loadMemoryLevelOverrides(overrides);
+
+    JValueUtil::getValue(config, "psi", "someThreshold", m_psiSomeThreshold);
+    JValueUtil::getValue(config, "psi", "fullThreshold", m_psiFullThreshold);
+    JValueUtil::getValue(config, "psi", "window", m_psiWindow);
+
+    JValueUtil::getValue(config, "sampling", "minPeriod", m_samplingMinPeriod);
+    JValueUtil::getValue(config, "sampling", "maxPeriod", m_samplingMaxPeriod);
+    JValueUtil::getValue(config, "sampling", "band", m_samplingBand);
+    JValueUtil::getValue(config, "sampling", "actionPeriod", m_samplingActionPeriod);
+    if (m_samplingMinPeriod <= 0 || m_samplingMaxPeriod < m_samplingMinPeriod) {
+        Logger::error("Invalid sampling period, use default", "SettingManager");
+        m_samplingMinPeriod = 200;
+        m_samplingMaxPeriod = 5000;
+    }
+
+    JValueUtil::getValue(config, "prediction", "horizon", m_predictionHorizon);
+
+    JValueUtil::getValue(config, "sampler", "thread", m_samplerThread);
+    JValueUtil::getValue(config, "sampler", "priority", m_samplerPriority);
+
+    JValueUtil::getValue(config, "vmstat", "period", m_vmStatPeriod);
+    JValueUtil::getValue(config, "vmstat", "refaultFloor", m_vmStatRefaultFloor);
+    JValueUtil::getValue(config, "vmstat", "thrashingLow", m_thrashingLow);
+    JValueUtil::getValue(config, "vmstat", "thrashingCritical", m_thrashingCritical);
+
+    JValueUtil::getValue(config, "pss", "workers", m_pssWorkers);
+    JValueUtil::getValue(config, "pss", "topN", m_pssTopN);
+    JValueUtil::getValue(config, "pss", "rssDelta", m_pssRssDelta);
+    JValueUtil::getValue(config, "pss", "period", m_pssPeriod);
+    if (m_pssWorkers < 0)
+        m_pssWorkers = 0;
+
+    JValueUtil::getValue(config, "swap", "period", m_swapPeriod);
+    JValueUtil::getValue(config, "swap", "fullRatio", m_swapFullRatio);
+    JValueUtil::getValue(config, "swap", "effective", m_swapEffective);
+
+    JValueUtil::getValue(config, "victim", "age", m_victimWeightAge);
+    JValueUtil::getValue(config, "victim", "size", m_victimWeightSize);
+    JValueUtil::getValue(config, "victim", "swap", m_victimWeightSwap);
+    JValueUtil::getValue(config, "victim", "oom", m_victimWeightOom);
+    JValueUtil::getValue(config, "victim", "web", m_victimWeightWeb);
+    JValueUtil::getValue(config, "victim", "maxCount", m_victimMaxCount);
+
+    JValue protectedApps;
+    if (JValueUtil::getValue(config, "victim", "protected", protectedApps) &&
+        protectedApps.isArray()) {
+        for (JValue appId : protectedApps.items()) {
+            if (appId.isString())
+                m_protectedApps.insert(appId.asString());
+        }
+    }
+
+    JValueUtil::getValue(config, "planner", "settle", m_plannerSettle);
+
+    JValueUtil::getValue(config, "reclaim", "enable", m_reclaimEnable);
+    JValueUtil::getValue(config, "reclaim", "swappiness", m_reclaimSwappiness);
+    if (m_reclaimSwappiness > 200)
+        m_reclaimSwappiness = 200;
+    JValueUtil::getValue(config, "reclaim", "chunk", m_reclaimChunk);
+    if (m_reclaimChunk <= 0)
+        m_reclaimChunk = 16384;
+
+    JValueUtil::getValue(config, "freeze", "enable", m_freezeEnable);
+    JValueUtil::getValue(config, "freeze", "idle", m_freezeIdle);
+
+    JValueUtil::getValue(config, "pageout", "enable", m_pageoutEnable);
+    JValueUtil::getValue(config, "pageout", "cold", m_pageoutCold);
+    JValueUtil::getValue(config, "pageout", "idle", m_pageoutIdle);
+
+    JValueUtil::getValue(config, "admission", "lease", m_admissionLease);
+
+    JValueUtil::getValue(config, "profile", "path", m_profilePath);
+    JValueUtil::getValue(config, "profile", "window", m_profileWindow);
+    JValueUtil::getValue(config, "profile", "records", m_profileRecords);
+
+    Logger::normal("Configuration loaded from " + path, "SettingManager");
 }
 
 int SettingManager::getMemoryLevelLowEnter()
@@ -69,6 +508,226 @@ int SettingManager::getMemoryLevelCriticalExit()
     return m_memoryLevelCriticalExit;
 }
 
+int SettingManager::getMemoryLevelCount()
+{
+    return m_memoryLevelCount;
+}
+
+const MemoryLevelSetting& SettingManager::getMemoryLevel(int index)
+{
+    return m_memoryLevels[index];
+}
+
+const string& SettingManager::getMemoryLevelSource()
+{
+    return m_memoryLevelSource;
+}
+
+int SettingManager::getPsiSomeThreshold()
+{
+    return m_psiSomeThreshold;
+}
+
+int SettingManager::getPsiFullThreshold()
+{
+    return m_psiFullThreshold;
+}
+
+int SettingManager::getPsiWindow()
+{
+    return m_psiWindow;
+}
+
+int SettingManager::getSamplingMinPeriod()
+{
+    return m_samplingMinPeriod;
+}
+
+int SettingManager::getSamplingMaxPeriod()
+{
+    return m_samplingMaxPeriod;
+}
+
+int SettingManager::getSamplingBand()
+{
+    return m_samplingBand;
+}
+
+int SettingManager::getSamplingActionPeriod()
+{
+    return m_samplingActionPeriod;
+}
+
+int SettingManager::getPredictionHorizon()
+{
+    return m_predictionHorizon;
+}
+
+bool SettingManager::getSamplerThread()
+{
+    return m_samplerThread;
+}
+
+int SettingManager::getSamplerPriority()
+{
+    return m_samplerPriority;
+}
+
+int SettingManager::getVmStatPeriod()
+{
+    return m_vmStatPeriod;
+}
+
+int SettingManager::getVmStatRefaultFloor()
+{
+    return m_vmStatRefaultFloor;
+}
+
+int SettingManager::getThrashingLow()
+{
+    return m_thrashingLow;
+}
+
+int SettingManager::getThrashingCritical()
+{
+    return m_thrashingCritical;
+}
+
+int SettingManager::getPssWorkers()
+{
+    return m_pssWorkers;
+}
+
+int SettingManager::getPssTopN()
+{
+    return m_pssTopN;
+}
+
+int SettingManager::getPssRssDelta()
+{
+    return m_pssRssDelta;
+}
+
+int SettingManager::getPssPeriod()
+{
+    return m_pssPeriod;
+}
+
+int SettingManager::getSwapPeriod()
+{
+    return m_swapPeriod;
+}
+
+int SettingManager::getSwapFullRatio()
+{
+    return m_swapFullRatio;
+}
+
+bool SettingManager::getSwapEffective()
+{
+    return m_swapEffective;
+}
+
+int SettingManager::getVictimWeightAge()
+{
+    return m_victimWeightAge;
+}
+
+int SettingManager::getVictimWeightSize()
+{
+    return m_victimWeightSize;
+}
+
+int SettingManager::getVictimWeightSwap()
+{
+    return m_victimWeightSwap;
+}
+
+int SettingManager::getVictimWeightOom()
+{
+    return m_victimWeightOom;
+}
+
+int SettingManager::getVictimWeightWeb()
+{
+    return m_victimWeightWeb;
+}
+
+int SettingManager::getVictimMaxCount()
+{
+    return m_victimMaxCount;
+}
+
+bool SettingManager::isProtectedApp(const string& appId)
+{
+    return m_protectedApps.find(appId) != m_protectedApps.end();
+}
+
+int SettingManager::getPlannerSettle()
+{
+    return m_plannerSettle;
+}
+
+bool SettingManager::getReclaimEnable()
+{
+    return m_reclaimEnable;
+}
+
+int SettingManager::getReclaimSwappiness()
+{
+    return m_reclaimSwappiness;
+}
+
+int SettingManager::getReclaimChunk()
+{
+    return m_reclaimChunk;
+}
+
+bool SettingManager::getFreezeEnable()
+{
+    return m_freezeEnable;
+}
+
+int SettingManager::getFreezeIdle()
+{
+    return m_freezeIdle;
+}
+
+bool SettingManager::getPageoutEnable()
+{
+    return m_pageoutEnable;
+}
+
+int SettingManager::getPageoutCold()
+{
+    return m_pageoutCold;
+}
+
+int SettingManager::getPageoutIdle()
+{
+    return m_pageoutIdle;
+}
+
+int SettingManager::getAdmissionLease()
+{
+    return m_admissionLease;
+}
+
+const string& SettingManager::getProfilePath()
+{
+    return m_profilePath;
+}
+
+int SettingManager::getProfileWindow()
+{
+    return m_profileWindow;
+}
+
+int SettingManager::getProfileRecords()
+{
+    return m_profileRecords;
+}
+
 bool SettingManager::getSingleAppPolicy()
 {
     return m_SingleAppPolicy;
@@ -84,5 +743,8 @@ int SettingManager::loadSetting()
     // From build environment
     initEnv();
 
+    // From configuration file
+    loadConfig();
+
     return 0;
 }
@@ -18,13 +18,28 @@
 #define SETTING_SETTINGMANAGER_H_
 
 #include <iostream>
+#include <set>
 #include <pbnjson.hpp>
 
 using namespace std;
 using namespace pbnjson;
 
+/*
+ * One tier of memory level. Tier 0 is normal and has no thresholds, each
+ * next tier is entered below a lower 'enter' and left above its 'exit'.
+ */
+struct MemoryLevelSetting {
+    string name;
+    int enter;      // MB of available memory to enter this tier
+    int exit;       // MB of available memory to leave this tier
+    int dwell;      // ms to stay at least before going to a lower tier
+    string action;  // "none", "reclaim", "low" or "critical"
+};
+
 class SettingManager {
 public:
+    static const int MAX_MEMORY_LEVELS = 8;
+
     static int loadSetting();
 
     // From build environment
@@ -35,18 +50,149 @@ public:
     static int getMemoryLevelLowExit();
     static int getMemoryLevelCriticalEnter();
     static int getMemoryLevelCriticalExit();
+    static int getMemoryLevelCount();
+    static const MemoryLevelSetting& getMemoryLevel(int index);
+    static const string& getMemoryLevelSource();
+
+    // From configuration file
+    static int getPsiSomeThreshold();
+    static int getPsiFullThreshold();
+    static int getPsiWindow();
+
+    static int getSamplingMinPeriod();
+    static int getSamplingMaxPeriod();
+    static int getSamplingBand();
+    static int getSamplingActionPeriod();
+
+    static int getPredictionHorizon();
+
+    static bool getSamplerThread();
+    static int getSamplerPriority();
+
+    static int getVmStatPeriod();
+    static int getVmStatRefaultFloor();
+    static int getThrashingLow();
+    static int getThrashingCritical();
+
+    static int getPssWorkers();
+    static int getPssTopN();
+    static int getPssRssDelta();
+    static int getPssPeriod();
+
+    static int getSwapPeriod();
+    static int getSwapFullRatio();
+    static bool getSwapEffective();
+
+    static int getVictimWeightAge();
+    static int getVictimWeightSize();
+    static int getVictimWeightSwap();
+    static int getVictimWeightOom();
+    static int getVictimWeightWeb();
+    static int getVictimMaxCount();
+    static bool isProtectedApp(const string& appId);
+
+    static int getPlannerSettle();
+
+    static bool getReclaimEnable();
+    static int getReclaimSwappiness();
+    static int getReclaimChunk();
+
+    static bool getFreezeEnable();
+    static int getFreezeIdle();
+
+    static bool getPageoutEnable();
+    static int getPageoutCold();
+    static int getPageoutIdle();
+
+    static int getAdmissionLease();
+
+    static const string& getProfilePath();
+    static int getProfileWindow();
+    static int getProfileRecords();
 
 private:
     static void initEnv();
+    static void loadConfig();
+    static void setDefaultMemoryLevels();
+    static void deriveMemoryLevels();
+    static bool loadMemoryLevels(JValue& levels);
+    static void loadMemoryLevelOverrides(JValue& overrides);
+    static void updateMemoryLevels();
+
+    static const string CONFIG_FILE;
+    static const int REFERENCE_MEM_TOTAL;
 
     // From build environmena
     static bool m_SingleAppPolicy;
     static bool m_SessionEnabled;
 
+    /* Tiers ordered from normal to the most severe one */
+    static MemoryLevelSetting m_memoryLevels[MAX_MEMORY_LEVELS];
+    static int m_memoryLevelCount;
+    static string m_memoryLevelSource; // "default", "derived", "config" or "override"
+    static int m_memTotal;          // MB of RAM which levels are derived from
+
+    /* First "low" and "critical" tiers, used by reclaim targets */
     static int m_memoryLevelLowEnter;
     static int m_memoryLevelLowExit;
     static int m_memoryLevelCriticalEnter;
     static int m_memoryLevelCriticalExit;
+
+    // From configuration file
+    static int m_psiSomeThreshold;  // us of stall in window
+    static int m_psiFullThreshold;  // us of stall in window
+    static int m_psiWindow;         // us
+
+    static int m_samplingMinPeriod; // ms, near or below low level
+    static int m_samplingMaxPeriod; // ms, deep in normal level
+    static int m_samplingBand;      // MB above low enter to sample at max period
+    static int m_samplingActionPeriod; // ms between actions while a tier is kept
+
+    static int m_predictionHorizon; // ms, reclaim early if critical is closer
+
+    static bool m_samplerThread;    // sample on dedicated thread instead of main loop
+    static int m_samplerPriority;   // SCHED_FIFO priority of sampler thread, 0 for default
+
+    static int m_vmStatPeriod;      // ms
+    static int m_vmStatRefaultFloor;// refaulted pages per second to be considered
+    static int m_thrashingLow;      // thrashing score to reclaim as low
+    static int m_thrashingCritical; // thrashing score to reclaim as critical
+
+    static int m_pssWorkers;        // threads reading smaps_rollup, 0 reads on main loop
+    static int m_pssTopN;           // biggest processes whose PSS is read every time
+    static int m_pssRssDelta;       // KB of RSS change to read PSS again
+    static int m_pssPeriod;         // ms to refresh memory usage, 0 to disable
+
+    static int m_swapPeriod;        // ms
+    static int m_swapFullRatio;     // % of swap or zram limit used to be full
+    static bool m_swapEffective;    // decide level with zram gain added
+
+    static int m_victimWeightAge;   // weights of victim features
+    static int m_victimWeightSize;
+    static int m_victimWeightSwap;
+    static int m_victimWeightOom;
+    static int m_victimWeightWeb;
+    static int m_victimMaxCount;    // apps closed at once for a deficit
+    static set<string> m_protectedApps;
+
+    static int m_plannerSettle;     // ms to wait for planned victims to exit
+
+    static bool m_reclaimEnable;    // memory.reclaim background apps before closing
+    static int m_reclaimSwappiness; // swappiness hint to memory.reclaim, -1 to omit
+    static int m_reclaimChunk;      // KB asked by one memory.reclaim write at most
+
+    static bool m_freezeEnable;     // freeze idle background apps on low level
+    static int m_freezeIdle;        // ms in background to be frozen
+
+    static bool m_pageoutEnable;    // process_madvise apps sharing a cgroup on low level
+    static int m_pageoutCold;       // ms in background to be MADV_COLD
+    static int m_pageoutIdle;       // ms in background to be MADV_PAGEOUT
+
+    static int m_admissionLease;    // ms to hold memory granted by requireMemory
+
+    static string m_profilePath;    // launch profile file, empty to disable
+    static int m_profileWindow;     // ms after launch to learn peak PSS
+    static int m_profileRecords;    // apps kept in launch profile
 };
 
 #endif /* SETTING_SETTINGMANAGER_H_ */